@@ -1,58 +1,94 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <functional>
 #include <iostream>
+#include <iterator>
 #include <limits>
 #include <numeric>
+#include <random>
 #include <stdexcept>
 #include <vector>
 #include "Core.hpp"
+#include "model_bundle.hpp"
+#include "../Dataset/Datasets.hpp"
 #include "../Optimizers/Optimizers.hpp"
 #include "../Utility/Utility.hpp"
+#include "../Utility/state_stream.hpp"
 
 namespace PHP2xAI::Runtime::CPP
 {
+	namespace
+	{
+		constexpr char StateMagic[4] = {'P', '2', 'X', 'S'};
+		constexpr uint64_t StateVersion = 1;
+		constexpr int MaxDatasetReaders = 64;
+	}
+
 	Core::Core(const std::string &configPath, const std::string &weightsPath)
 		: graphPath_(configPath), weightsPath_(weightsPath)
 	{
-		auto configDef = loadJson(graphPath_);
-		loadGraphRuntime(configDef);
+		auto config = JsonLoader::load(graphPath_);
+		const auto &configDef = config.doc;
+		loadGraphRuntime(configDef, std::move(config.tensorData));
 
 		if (configDef.contains("optimizer"))
 			loadOptimizer(configDef);
 
 		if (configDef.contains("train_data_file") && configDef.contains("val_data_file") && configDef.contains("batch_size"))
 			loadTrainValidateDataset(configDef);
+		else if (configDef.contains("train_token_file") && configDef.contains("val_token_file") && configDef.contains("batch_size"))
+			loadTokenStreamDataset(configDef);
+		else if (configDef.contains("train_ring") && configDef.contains("val_data_file") && configDef.contains("batch_size"))
+			loadShmRingDataset(configDef);
 
 		if (configDef.contains("save_Path"))
 			loadOutputPath(configDef);
 
+		loadCheckpointPolicy(configDef);
+
 		if (configDef.contains("epochs_number"))
 			loadEpochsNumber(configDef);
 
 		if (configDef.contains("log_on_each_x_batch"))
 			logOnEachXBatch_ = configDef.at("log_on_each_x_batch").get<int>();
+
+		if (configDef.contains("trace_path"))
+			trace_ = std::make_unique<TraceRecorder>(configDef.at("trace_path").get<std::string>());
+
+		loadStatePolicy(configDef);
 	}
 	
-	json Core::loadJson(const std::string &path)
+	Core::Core(std::shared_ptr<const ModelBundle> bundle, bool shareWeights)
 	{
-		std::ifstream file(path);
+		graphRuntime_.emplace(std::move(bundle), shareWeights);
+		contexts_ = std::make_unique<ContextPool>(*graphRuntime_);
+	}
 
-		if (!file.is_open())
-			throw std::runtime_error("Unable to open graph file: " + path);
+	void Core::saveBundle(const std::string &path) const
+	{
+		if (!graphRuntime_)
+			throw std::runtime_error("Core not initialized");
 
-		json parsed;
-		file >> parsed;
-		return parsed;
+		ModelBundle::write(path, *graphRuntime_);
 	}
-	
-	void Core::loadGraphRuntime(const json &configDef)
+
+	void Core::loadGraphRuntime(const json &configDef, TensorDataMap graphData)
 	{
 		const auto &graphDef = configDef.at("graph");
-		graphRuntime_.emplace(graphDef, weightsPath_);
+		graphRuntime_.emplace(graphDef, weightsPath_, std::move(graphData), configDef.value("share_weights", true));
+		contexts_ = std::make_unique<ContextPool>(*graphRuntime_, configDef.value("inference_contexts", std::size_t{0}));
+		graphRuntime_->setProfiling(configDef.value("profile", false));
 	}
 	
 	void Core::loadOptimizer(const json &configDef)
 	{
-		const auto &optimizerDef = configDef.at("optimizer");
+		optimizer_ = createOptimizer(configDef.at("optimizer"));
+	}
+
+	std::unique_ptr<Optimizers::Optimizer> Core::createOptimizer(const json &optimizerDef)
+	{
 		const auto name = optimizerDef.at("name").get<std::string>();
 		const auto &params = optimizerDef.at("params");
 
@@ -63,35 +99,234 @@ namespace PHP2xAI::Runtime::CPP
 			const auto beta2 = params.value("beta2", 0.999f);
 			const auto eps = params.value("eps", 0.00000001f);
 
-			optimizer_ = std::make_unique<Optimizers::Adam>(learningRate, beta1, beta2, eps);
+			return std::make_unique<Optimizers::Adam>(learningRate, beta1, beta2, eps);
 		}
 		else if (name == "Fixed")
 		{
 			const auto learningRate = params.value("learningRate", 0.1f);
-			optimizer_ = std::make_unique<Optimizers::Fixed>(learningRate);
-		}
-		else
-		{
-			throw std::runtime_error("Unsupported optimizer: " + name);
+			return std::make_unique<Optimizers::Fixed>(learningRate);
 		}
+
+		throw std::runtime_error("Unsupported optimizer: " + name);
 	}
 	
 	void Core::loadTrainValidateDataset(const json &configDef)
 	{
-		const auto trainPath = configDef.at("train_data_file").get<std::string>();
-		const auto valPath = configDef.at("val_data_file").get<std::string>();
+		const auto trainPaths = loadDatasetPaths(configDef.at("train_data_file"));
+		const auto valPaths = loadDatasetPaths(configDef.at("val_data_file"));
+		const auto batchSize = static_cast<std::size_t>(configDef.at("batch_size").get<int>());
+		const auto readers = configDef.value("dataset_readers", 1);
+
+		// Each reader keeps one batch in flight, so the count bounds memory as well as threads
+		if (readers < 1 || readers > MaxDatasetReaders)
+			throw std::runtime_error("dataset_readers must be between 1 and " + std::to_string(MaxDatasetReaders));
+
+		// Variable-length sequences: batches of similar length, padded to the longest sample
+		if (configDef.value("bucket_by_length", false))
+		{
+			for (const char *key : {"dataset_readers", "dataset_cache_mb", "dataset_tailing"})
+			{
+				if (configDef.contains(key))
+					throw std::runtime_error(std::string(key) + " is not supported with bucket_by_length");
+			}
+
+			// Padding is masked in the label CE only: any other op that combines time steps would see the padded ones
+			if (const auto *op = graphRuntime_->timeMixingOp())
+				throw std::runtime_error("bucket_by_length: op " + std::to_string(op->id) + " (" + op->op
+					+ ") mixes the time axis and would see the padded steps");
+
+			const auto poolBatches = static_cast<std::size_t>(configDef.value("bucket_pool_batches", 50));
+
+			trainDataset_ = std::make_unique<BucketFileDataset>(trainPaths, batchSize, poolBatches);
+			valDataset_ = std::make_unique<BucketFileDataset>(valPaths, batchSize, poolBatches);
+			trainValDataset_.emplace(*trainDataset_, *valDataset_);
+			return;
+		}
+
+		auto train = std::make_unique<StreamFileDataset>(trainPaths, batchSize, '|', 42, static_cast<std::size_t>(readers));
+		auto val = std::make_unique<StreamFileDataset>(valPaths, batchSize, '|', 42, static_cast<std::size_t>(readers));
+
+		// Opt-in in-memory cache: budget in MB for each dataset, batches over budget keep streaming
+		if (configDef.contains("dataset_cache_mb"))
+		{
+			const auto budget = static_cast<std::size_t>(configDef.at("dataset_cache_mb").get<double>() * 1024.0 * 1024.0);
+			train->enableCache(budget);
+			val->enableCache(budget);
+		}
+
+		// Append-only training files: new lines are picked up at every epoch boundary
+		if (configDef.value("dataset_tailing", false))
+			train->enableTailing();
+
+		trainDataset_ = std::move(train);
+		valDataset_ = std::move(val);
+		trainValDataset_.emplace(*trainDataset_, *valDataset_);
+	}
+
+	void Core::loadTokenStreamDataset(const json &configDef)
+	{
+		const auto trainPath = configDef.at("train_token_file").get<std::string>();
+		const auto valPath = configDef.at("val_token_file").get<std::string>();
+		const auto batchSize = static_cast<std::size_t>(configDef.at("batch_size").get<int>());
+		const auto seqLen = static_cast<std::size_t>(configDef.at("seq_len").get<int>());
+		const auto tokenBytes = static_cast<std::size_t>(configDef.value("token_bytes", 2));
+		const auto stride = static_cast<std::size_t>(configDef.value("window_stride", 0));
+		const auto sampling = TokenStreamDataset::parseSampling(configDef.value("window_sampling", std::string("strided")));
+
+		trainDataset_ = std::make_unique<TokenStreamDataset>(trainPath, batchSize, seqLen, tokenBytes, sampling, stride);
+		// Validation always on fixed, non-overlapping windows
+		valDataset_ = std::make_unique<TokenStreamDataset>(valPath, batchSize, seqLen, tokenBytes);
+		trainValDataset_.emplace(*trainDataset_, *valDataset_);
+	}
+
+	void Core::loadShmRingDataset(const json &configDef)
+	{
+		const auto valPaths = loadDatasetPaths(configDef.at("val_data_file"));
 		const auto batchSize = static_cast<std::size_t>(configDef.at("batch_size").get<int>());
 
-		trainDataset_.emplace(trainPath, batchSize);
-		valDataset_.emplace(valPath, batchSize);
+		// Training batches pushed by another process through shared memory, validation from file
+		trainDataset_ = std::make_unique<ShmRingDataset>(configDef.at("train_ring").get<std::string>());
+		valDataset_ = std::make_unique<StreamFileDataset>(valPaths, batchSize);
 		trainValDataset_.emplace(*trainDataset_, *valDataset_);
 	}
+
+	std::vector<std::string> Core::loadDatasetPaths(const json &pathDef)
+	{
+		// A single file, a glob ("shards/train-*.txt") or a list of files/globs
+		std::vector<std::string> patterns;
+
+		if (pathDef.is_array())
+			patterns = pathDef.get<std::vector<std::string>>();
+		else
+			patterns.push_back(pathDef.get<std::string>());
+
+		std::vector<std::string> paths;
+
+		for (const auto &pattern : patterns)
+		{
+			const auto expanded = StreamFileDataset::expandPaths(pattern);
+			paths.insert(paths.end(), expanded.begin(), expanded.end());
+		}
+
+		return paths;
+	}
 	
 	void Core::loadOutputPath(const json &configDef)
 	{
 		outputPath_ = configDef.at("save_Path").get<std::string>();
 	}
+
+	void Core::loadCheckpointPolicy(const json &configDef)
+	{
+		checkpointEveryXBatch_ = configDef.value("checkpoint_every_x_batch", 0);
+		checkpointSync_ = CheckpointWriter::parseSync(configDef.value("checkpoint_fsync", std::string("file")));
+
+		if (configDef.contains("checkpoint_path"))
+		{
+			checkpointPath_ = configDef.at("checkpoint_path").get<std::string>();
+		}
+		else if (!outputPath_.empty())
+		{
+			// Periodic checkpoints must not overwrite the best weights: "model.bin" -> "model.last.bin"
+			const auto dot = outputPath_.find_last_of('.');
+			const auto slash = outputPath_.find_last_of('/');
+			const bool hasExt = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+
+			checkpointPath_ = hasExt
+				? outputPath_.substr(0, dot) + ".last" + outputPath_.substr(dot)
+				: outputPath_ + ".last";
+		}
+	}
 	
+	void Core::loadStatePolicy(const json &configDef)
+	{
+		statePath_ = configDef.value("state_path", std::string());
+		stateEveryXBatch_ = configDef.value("state_every_x_batch", 0);
+
+		// Fail now rather than at the first state write, an epoch into the run
+		if (!statePath_.empty() && trainValDataset_ && !trainValDataset_->train.hasState())
+			throw std::runtime_error("state_path: the training dataset cannot save its position (e.g. train_ring)");
+
+		// Restart after preemption with the same config: resume if a state was written
+		if (configDef.value("resume", false) && !statePath_.empty() && std::ifstream(statePath_).good())
+		{
+			loadTrainingState(statePath_);
+			std::cout << "Resuming from epoch " << (resumeEpoch_ + 1) << ", batch " << resumeBatch_ << "\n";
+		}
+	}
+
+	void Core::serializeTrainingState(std::string &out, int epoch, std::size_t batch, Scalar bestLoss) const
+	{
+		out.clear();
+		StateWriter writer(out);
+
+		writer.raw(StateMagic, sizeof(StateMagic));
+		writer.u64(StateVersion);
+		writer.u64(static_cast<uint64_t>(epoch));
+		writer.u64(batch);
+		writer.f32(bestLoss);
+
+		const auto weights = graphRuntime_->trainableTensors();
+		writer.u64(weights.size());
+		for (const auto *t : weights)
+		{
+			writer.u64(static_cast<uint64_t>(t->id));
+			writer.u64(t->data.size());
+			writer.raw(t->data.data(), t->data.size() * sizeof(Scalar));
+		}
+
+		optimizer_->saveState(writer);
+		trainValDataset_->train.saveState(writer);
+	}
+
+	void Core::loadTrainingState(const std::string &path)
+	{
+		if (!trainValDataset_ || !graphRuntime_ || !optimizer_)
+			throw std::runtime_error("Core not initialized");
+
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			throw std::runtime_error("Unable to open training state: " + path);
+
+		const std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		StateReader reader(bytes.data(), bytes.size());
+
+		char magic[sizeof(StateMagic)];
+		reader.raw(magic, sizeof(magic));
+		if (std::memcmp(magic, StateMagic, sizeof(StateMagic)) != 0 || reader.u64() != StateVersion)
+			throw std::runtime_error("Invalid training state: " + path);
+
+		const auto epoch = static_cast<int>(reader.u64());
+		const auto batch = static_cast<std::size_t>(reader.u64());
+		const auto bestLoss = reader.f32();
+
+		auto &graph = *graphRuntime_;
+		const auto count = reader.u64();
+
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			const auto id = reader.u64();
+			auto data = reader.vector<Scalar>();
+
+			if (id >= graph.tensors.size() || graph.tensors[id].data.size() != data.size())
+				throw std::runtime_error("Training state does not match the graph: " + path);
+
+			// In place: execution contexts hold views of the param storage
+			std::copy(data.begin(), data.end(), graph.tensors[id].data.begin());
+		}
+
+		optimizer_->loadState(reader);
+		trainValDataset_->train.loadState(reader);
+
+		if (!reader.atEnd())
+			throw std::runtime_error("Invalid training state: " + path);
+
+		resumed_ = true;
+		resumeEpoch_ = epoch;
+		resumeBatch_ = batch;
+		resumeBestLoss_ = bestLoss;
+	}
+
 	void Core::loadEpochsNumber(const json &configDef)
 	{
 		epochsNumber_ = configDef.at("epochs_number").get<int>();
@@ -136,13 +371,344 @@ namespace PHP2xAI::Runtime::CPP
 		if (!graphRuntime_)
 			throw std::runtime_error("Core not initialized");
 		
-		auto &graph = *graphRuntime_;
+		const auto lease = contexts_->acquire();
+		auto &graph = lease.graph();
 		
 		graph.setInput(x);
 		graph.forward();
 		
 		return graph.getOutput();
 	}
+
+	ContextPool &Core::contexts()
+	{
+		if (!contexts_)
+			throw std::runtime_error("Core not initialized");
+
+		return *contexts_;
+	}
+
+	std::size_t Core::sampleInputSize() const
+	{
+		if (!graphRuntime_)
+			throw std::runtime_error("Core not initialized");
+
+		return graphRuntime_->sampleSize(graphRuntime_->inputId);
+	}
+
+	std::size_t Core::sampleOutputSize() const
+	{
+		if (!graphRuntime_)
+			throw std::runtime_error("Core not initialized");
+
+		return graphRuntime_->sampleSize(graphRuntime_->outputId);
+	}
+
+	std::size_t Core::maxBatchSize() const
+	{
+		if (!graphRuntime_)
+			throw std::runtime_error("Core not initialized");
+
+		const auto &graph = *graphRuntime_;
+		const bool batched = graph.tensors[graph.inputId].batched && graph.tensors[graph.outputId].batched;
+
+		return batched ? static_cast<std::size_t>(graph.getMaxBatchSize()) : 1;
+	}
+
+	bool Core::outputIsProbability() const
+	{
+		if (!graphRuntime_)
+			throw std::runtime_error("Core not initialized");
+
+		return outputIsProbability(*graphRuntime_);
+	}
+
+	bool Core::outputIsProbability(const GraphRuntime &graph)
+	{
+		return std::any_of(graph.ops.begin(), graph.ops.end(), [&](const Op &op)
+		{
+			return op.output == graph.outputId && op.op == "softmax";
+		});
+	}
+
+	void Core::predictBatch(const Scalar *x, std::size_t n, Scalar *out)
+	{
+		if (!graphRuntime_)
+			throw std::runtime_error("Core not initialized");
+
+		const auto lease = contexts_->acquire();
+		predictBatch(lease.graph(), x, n, out);
+	}
+
+	void Core::predictBatch(GraphRuntime &graph, const Scalar *x, std::size_t n, Scalar *out)
+	{
+		const auto outSize = graph.sampleSize(graph.outputId);
+
+		forEachOutputChunk(graph, x, n, [&](std::size_t first, std::size_t rows, const Scalar *output)
+		{
+			std::copy(output, output + rows * outSize, out + first * outSize);
+		});
+	}
+
+	void Core::forEachOutputChunk(
+		GraphRuntime &graph,
+		const Scalar *x,
+		std::size_t n,
+		const std::function<void(std::size_t first, std::size_t rows, const Scalar *output)> &sink)
+	{
+		const bool batched = graph.tensors[graph.inputId].batched && graph.tensors[graph.outputId].batched;
+		const auto inSize = graph.sampleSize(graph.inputId);
+
+		// Graphs without a batch axis on both ends run one sample per forward
+		const std::size_t maxRows = batched ? static_cast<std::size_t>(graph.getMaxBatchSize()) : 1;
+
+		std::vector<Scalar> chunk;
+
+		for (std::size_t first = 0; first < n; first += maxRows)
+		{
+			const auto rows = std::min(maxRows, n - first);
+
+			chunk.assign(x + first * inSize, x + (first + rows) * inSize);
+			graph.swapInput(chunk);
+			graph.forward();
+
+			sink(first, rows, graph.tensors[graph.outputId].data.data());
+		}
+	}
+
+	void Core::predictLabelIntBatch(const Scalar *x, std::size_t n, int *labels)
+	{
+		if (!graphRuntime_)
+			throw std::runtime_error("Core not initialized");
+
+		const auto lease = contexts_->acquire();
+		predictLabelIntBatch(lease.graph(), x, n, labels);
+	}
+
+	void Core::predictLabelIntBatch(GraphRuntime &graph, const Scalar *x, std::size_t n, int *labels)
+	{
+		const auto outSize = graph.sampleSize(graph.outputId);
+
+		forEachOutputChunk(graph, x, n, [&](std::size_t first, std::size_t rows, const Scalar *output)
+		{
+			for (std::size_t i = 0; i < rows; ++i)
+			{
+				const auto row = output + i * outSize;
+				labels[first + i] = static_cast<int>(std::max_element(row, row + outSize) - row);
+			}
+		});
+	}
+
+	void Core::predictTopKBatch(const Scalar *x, std::size_t n, std::size_t k, int *ids, Scalar *scores)
+	{
+		if (!graphRuntime_)
+			throw std::runtime_error("Core not initialized");
+
+		const auto lease = contexts_->acquire();
+		predictTopKBatch(lease.graph(), x, n, k, ids, scores);
+	}
+
+	void Core::predictTopKBatch(GraphRuntime &graph, const Scalar *x, std::size_t n, std::size_t k, int *ids, Scalar *scores)
+	{
+		const auto outSize = graph.sampleSize(graph.outputId);
+
+		// A trailing softmax already produced probabilities: rank them as they are
+		const bool softmax = !outputIsProbability(graph);
+
+		forEachOutputChunk(graph, x, n, [&](std::size_t first, std::size_t rows, const Scalar *output)
+		{
+			for (std::size_t i = 0; i < rows; ++i)
+			{
+				auto *rowIds = ids + (first + i) * k;
+				auto *rowScores = scores + (first + i) * k;
+
+				const auto found = Utility::topK(output + i * outSize, outSize, k, softmax, rowIds, rowScores);
+				std::fill(rowIds + found, rowIds + k, -1);
+				std::fill(rowScores + found, rowScores + k, 0.0f);
+			}
+		});
+	}
+
+	std::vector<int> Core::generate(const std::vector<int> &prompt, const GenerateOptions &options)
+	{
+		if (!graphRuntime_)
+			throw std::runtime_error("Core not initialized");
+
+		const auto lease = contexts_->acquire();
+		return generate(lease.graph(), prompt, options);
+	}
+
+	std::vector<int> Core::generate(GraphRuntime &graph, const std::vector<int> &prompt, const GenerateOptions &options)
+	{
+		const auto &input = graph.tensors[graph.inputId];
+		const auto &output = graph.tensors[graph.outputId];
+
+		if (input.timeAxes != std::vector<int>{1} || output.timeAxes != std::vector<int>{1} || input.getRank() != 3 || output.getRank() != 3)
+			throw std::runtime_error("generate: graph needs a [B, T, D] input and a [B, T, V] output");
+
+		const auto vocab = static_cast<std::size_t>(output.shape[2]);
+		const auto features = static_cast<std::size_t>(input.shape[2]);
+		const bool oneHot = features == vocab;
+
+		if (features != 1 && !oneHot)
+			throw std::runtime_error("generate: input must be [B, T, 1] token ids or [B, T, V] one-hot");
+
+		if (prompt.empty())
+			throw std::runtime_error("generate: empty prompt");
+
+		for (int token : prompt)
+		{
+			if (token < 0 || static_cast<std::size_t>(token) >= vocab)
+				throw std::runtime_error("generate: token " + std::to_string(token) + " out of vocabulary");
+		}
+
+		const bool incremental = decodesIncrementally(graph);
+		const bool probabilities = outputIsProbability(graph);
+		const bool greedy = options.temperature <= 0.0f || options.topK == 1;
+		const auto k = options.topK == 0 ? vocab : std::min(options.topK, vocab);
+		const auto window = static_cast<std::size_t>(graph.getMaxSequenceLength());
+
+		const int batchSize = graph.getBatchSize();
+		const int steps = graph.getSequenceLength();
+
+		std::mt19937_64 rng(options.seed != 0 ? options.seed : std::random_device{}());
+		std::vector<Scalar> scaled(greedy ? 0 : vocab);
+		std::vector<int> ids(greedy ? 0 : k);
+		std::vector<Scalar> scores(greedy ? 0 : k);
+
+		std::vector<int> tokens(prompt);
+		std::vector<int> generated;
+		generated.reserve(options.maxNewTokens);
+
+		try
+		{
+			graph.setBatchSize(1);
+
+			while (generated.size() < options.maxNewTokens)
+			{
+				const auto length = incremental ? 1 : std::min(tokens.size(), window);
+				const auto first = tokens.size() - length;
+
+				graph.setSequenceLength(static_cast<int>(length));
+
+				auto &x = graph.tensors[graph.inputId].data;
+				std::fill(x.begin(), x.end(), 0.0f);
+
+				for (std::size_t t = 0; t < length; ++t)
+				{
+					if (oneHot)
+						x[t * vocab + static_cast<std::size_t>(tokens[first + t])] = 1.0f;
+					else
+						x[t] = static_cast<Scalar>(tokens[first + t]);
+				}
+
+				graph.forward();
+
+				const Scalar *row = graph.tensors[graph.outputId].data.data() + (length - 1) * vocab;
+				int next = 0;
+
+				if (greedy)
+				{
+					next = static_cast<int>(std::max_element(row, row + vocab) - row);
+				}
+				else
+				{
+					// Temperature applies to logits: probabilities go back to log space first
+					for (std::size_t i = 0; i < vocab; ++i)
+					{
+						const auto logit = probabilities
+							? std::log(std::max(row[i], std::numeric_limits<Scalar>::min()))
+							: row[i];
+						scaled[i] = logit / options.temperature;
+					}
+
+					const auto found = Utility::topK(scaled.data(), vocab, k, true, ids.data(), scores.data());
+					const auto mass = std::accumulate(scores.begin(), scores.begin() + found, 0.0f);
+					auto r = std::uniform_real_distribution<Scalar>(0.0f, mass)(rng);
+
+					next = ids[found - 1];
+					for (std::size_t i = 0; i < found; ++i)
+					{
+						if (r < scores[i])
+						{
+							next = ids[i];
+							break;
+						}
+						r -= scores[i];
+					}
+				}
+
+				if (next == options.stopToken)
+					break;
+
+				generated.push_back(next);
+				tokens.push_back(next);
+			}
+		}
+		catch (...)
+		{
+			graph.setSequenceLength(steps);
+			graph.setBatchSize(batchSize);
+			throw;
+		}
+
+		// Leave the context shaped as predict*() expects it
+		graph.setSequenceLength(steps);
+		graph.setBatchSize(batchSize);
+
+		return generated;
+	}
+
+	bool Core::decodesIncrementally(const GraphRuntime &graph)
+	{
+		for (const auto &op : graph.ops)
+		{
+			const auto &out = graph.tensors[op.output];
+
+			bool timed = false;
+			for (int id : op.inputs)
+				timed = timed || !graph.tensors[id].timeAxes.empty();
+
+			if (timed)
+			{
+				// Position-wise: the output keeps the time axis and no step reads another step
+				if (out.timeAxes.size() != 1)
+					return false;
+
+				if (op.op == "matmul")
+				{
+					const auto &a = graph.tensors[op.inputs[0]];
+					const auto &b = graph.tensors[op.inputs[1]];
+
+					if (a.timeAxes.empty() || !b.timeAxes.empty() || a.isTimeAxis(-1))
+						return false;
+				}
+				else if (op.op == "softmax")
+				{
+					const int axis = op.axes.empty() ? -1 : op.axes[0];
+					if (out.isTimeAxis(axis))
+						return false;
+				}
+				else if (op.op == "mean")
+				{
+					const auto &a = graph.tensors[op.inputs[0]];
+					const int axis = op.axes.empty() ? 0 : op.axes[0];
+					if (a.isTimeAxis(axis))
+						return false;
+				}
+				else if (op.op != "add" && op.op != "dropout" && op.op != "sig"
+					&& op.op != "relu" && op.op != "ReLU")
+				{
+					return false;
+				}
+			}
+
+			if (op.output == graph.outputId)
+				return true;
+		}
+
+		return true;
+	}
 	
 	void Core::train()
 	{
@@ -155,31 +721,62 @@ namespace PHP2xAI::Runtime::CPP
 		std::vector<Scalar> x;
 		std::vector<Scalar> y;
 		auto betterValidationLoss = std::numeric_limits<Scalar>::max();
+		auto *trace = trace_.get();
+		CheckpointWriter checkpoints(checkpointSync_, trace);
+		std::string stateBytes;
+		int firstEpoch = 0;
+
+		// Reading the next batch is where an input-bound run waits
+		const auto nextBatch = [&]
+		{
+			TraceRecorder::Span span(trace, "next_batch", "data");
+			return dataset.train.nextBatch();
+		};
+
+		if (trace)
+			trace->nameThread("train");
+
+		if (resumed_)
+		{
+			firstEpoch = resumeEpoch_;
+			betterValidationLoss = resumeBestLoss_;
+		}
 		
-		for (int i = 0; i < epochsNumber_; ++i)
+		for (int i = firstEpoch; i < epochsNumber_; ++i)
 		{
 			std::cout << "Epoch " << (i + 1) << "\n";
 			std::cout << "------------------------\n";
 			std::cout.flush();
-			
-			dataset.train.shuffleEpoch();
+
+			TraceRecorder::Span epochSpan(trace, "epoch", "epoch");
 			std::size_t indice = 0;
+
+			// Mid-epoch resume: the dataset already holds the saved order and position
+			if (resumed_ && i == resumeEpoch_ && resumeBatch_ > 0)
+				indice = resumeBatch_;
+			else
+			{
+				TraceRecorder::Span span(trace, "shuffle", "data");
+				dataset.train.shuffleEpoch();
+			}
+
+			resumed_ = false;
+			const auto firstBatch = indice;
 			
-			while (dataset.train.nextBatch())
+			while (nextBatch())
 			{
-				graph.resetGrad();
-				graph.setLossGrad(1.0f);
-				
-				dataset.train.pack(x, y);
-				
-				graph.setInput(x);
-				graph.setTarget(y);
-				graph.forward();
-				
-				const auto error = graph.getError();
-				
-				graph.backward();
-				optimizer_->step(graph);
+				{
+					TraceRecorder::Span span(trace, "pack", "data");
+					dataset.train.pack(x, y);
+
+					if (const int steps = dataset.train.sequenceLength(); steps > 0)
+						graph.setSequenceLength(steps);
+					
+					graph.swapInput(x);
+					graph.swapTarget(y);
+				}
+
+				const auto error = trainStep(graph, *optimizer_, trace);
 				
 // 				while (dataset.train.nextSampleInBatch(x, y))
 // 				{
@@ -197,6 +794,19 @@ namespace PHP2xAI::Runtime::CPP
 // 				optimizer_->zeroGrads(graph);
 				
 				++indice;
+
+				if (checkpointEveryXBatch_ > 0 && !checkpointPath_.empty() && (indice % checkpointEveryXBatch_) == 0)
+				{
+					TraceRecorder::Span span(trace, "checkpoint_submit", "io");
+					checkpoints.submit(graph, checkpointPath_);
+				}
+
+				if (stateEveryXBatch_ > 0 && !statePath_.empty() && (indice % stateEveryXBatch_) == 0)
+				{
+					TraceRecorder::Span span(trace, "state_submit", "io");
+					serializeTrainingState(stateBytes, i, indice, betterValidationLoss);
+					checkpoints.submitBytes(statePath_, stateBytes);
+				}
 				
 				if (logOnEachXBatch_ > 0 && (indice % logOnEachXBatch_) == 0)
 				{
@@ -204,8 +814,31 @@ namespace PHP2xAI::Runtime::CPP
 					std::cout.flush();
 				}
 			}
+
+			// The producer closed the training stream: a partial epoch is still validated, an empty one ends the run
+			const bool closed = dataset.train.closed();
+
+			if (closed && indice == firstBatch)
+			{
+				std::cout << "Training data closed\n";
+				std::cout.flush();
+				break;
+			}
 			
-			const auto valLoss = validationLoss();
+			if (graph.isProfiling())
+			{
+				std::cout << "------------------------\n";
+				std::cout << "Op profile epoch " << (i + 1) << "\n" << graph.profile()->report();
+				std::cout.flush();
+			}
+
+			Scalar valLoss{};
+			{
+				TraceRecorder::Span span(trace, "validation", "validation");
+				valLoss = validationLoss();
+			}
+			// The next epoch's profile covers its training steps only
+			graph.resetProfile();
 			
 			std::cout << "------------------------\n";
 			std::cout << "Validation error: " << valLoss << "\n";
@@ -214,7 +847,8 @@ namespace PHP2xAI::Runtime::CPP
 			if (!outputPath_.empty() && valLoss < betterValidationLoss)
 			{
 				betterValidationLoss = valLoss;
-				graph.saveWeightsToJson(outputPath_);
+				TraceRecorder::Span span(trace, "checkpoint_submit", "io");
+				checkpoints.submit(graph, outputPath_);
 			}
 			else
 			{
@@ -224,9 +858,60 @@ namespace PHP2xAI::Runtime::CPP
 			}
 			std::cout << "------------------------\n";
 			std::cout.flush();
+
+			if (!statePath_.empty())
+			{
+				TraceRecorder::Span span(trace, "state_submit", "io");
+				serializeTrainingState(stateBytes, i + 1, 0, betterValidationLoss);
+				checkpoints.submitBytes(statePath_, stateBytes);
+			}
+
+			if (trace)
+				trace->flush();
+
+			if (closed)
+			{
+				std::cout << "Training data closed\n";
+				std::cout.flush();
+				break;
+			}
+		}
+
+		checkpoints.flush();
+
+		if (trace)
+		{
+			trace->flush();
+
+			if (trace->dropped() > 0)
+				std::cerr << "Trace: " << trace->dropped() << " events dropped, a thread filled its buffer within one epoch\n";
 		}
 	}
 
+	Scalar Core::trainStep(GraphRuntime &graph, Optimizers::Optimizer &optimizer, TraceRecorder *trace)
+	{
+		Scalar error{};
+
+		{
+			TraceRecorder::Span span(trace, "forward");
+			graph.resetGrad();
+			graph.setLossGrad(1.0f);
+			graph.forward();
+
+			error = graph.getError();
+		}
+
+		{
+			TraceRecorder::Span span(trace, "backward");
+			graph.backward();
+		}
+
+		TraceRecorder::Span span(trace, "optimizer_step");
+		optimizer.step(graph);
+
+		return error;
+	}
+
 	Scalar Core::validationLoss()
 	{
 		if (!trainValDataset_ || !graphRuntime_)
@@ -240,14 +925,24 @@ namespace PHP2xAI::Runtime::CPP
 		Scalar loss = 0.0f;
 		std::size_t count = 0;
 
+		auto *trace = trace_.get();
+
 		dataset.resetEpoch();
 
 		while (dataset.nextBatch())
 		{
-			dataset.pack(x, y);
-			
-			graph.setInput(x);
-			graph.setTarget(y);
+			{
+				TraceRecorder::Span span(trace, "pack", "validation");
+				dataset.pack(x, y);
+
+				if (const int steps = dataset.sequenceLength(); steps > 0)
+					graph.setSequenceLength(steps);
+				
+				graph.swapInput(x);
+				graph.swapTarget(y);
+			}
+
+			TraceRecorder::Span span(trace, "forward", "validation");
 			graph.forward();
 			
 			loss += graph.getError();
@@ -1,14 +1,20 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 #include "../types.hpp"
 #include "../Dataset/TrainValidateDataset.hpp"
 #include "../Optimizers/Optimizer.hpp"
 #include "../ThirdParty/nlohmann/json.hpp"
+#include "checkpoint_writer.hpp"
+#include "context_pool.hpp"
 #include "runtime.hpp"
+#include "trace_recorder.hpp"
 
 namespace PHP2xAI::Runtime::CPP
 {
@@ -18,6 +24,9 @@ namespace PHP2xAI::Runtime::CPP
 	{
 	public:
 		explicit Core(const std::string &configPath, const std::string &weightsPath = "");
+		// Inference-only core from a single-file model bundle (no optimizer, no datasets). Shared
+		// weights stay in the bundle mapping, see GraphRuntime
+		explicit Core(std::shared_ptr<const ModelBundle> bundle, bool shareWeights = true);
 
 		void train();
 		Scalar validationLoss();
@@ -25,24 +34,99 @@ namespace PHP2xAI::Runtime::CPP
 		std::vector<Scalar> predict(const std::vector<Scalar> &x);
 		std::size_t inputSize() const;
 		std::size_t outputSize() const;
+		// Batched inference: x holds n samples of sampleInputSize() floats, out receives n rows of
+		// sampleOutputSize(). Runs in chunks of at most the graph's max batch size
+		void predictBatch(const Scalar *x, std::size_t n, Scalar *out);
+		void predictLabelIntBatch(const Scalar *x, std::size_t n, int *labels);
+		static void predictBatch(GraphRuntime &graph, const Scalar *x, std::size_t n, Scalar *out);
+		static void predictLabelIntBatch(GraphRuntime &graph, const Scalar *x, std::size_t n, int *labels);
+		// k best classes of each sample's output row, best first: softmax probabilities, or the output
+		// itself when the graph already ends in a softmax. ids/scores receive n * k entries, padded
+		// with id -1 when the row has fewer than k classes
+		void predictTopKBatch(const Scalar *x, std::size_t n, std::size_t k, int *ids, Scalar *scores);
+		static void predictTopKBatch(GraphRuntime &graph, const Scalar *x, std::size_t n, std::size_t k, int *ids, Scalar *scores);
+
+		struct GenerateOptions
+		{
+			std::size_t maxNewTokens = 32;
+			// 0: sample from the whole vocabulary
+			std::size_t topK = 0;
+			// 0: greedy decoding
+			Scalar temperature = 0.0f;
+			// 0: seeded from std::random_device
+			uint64_t seed = 0;
+			// Generation stops before emitting this token, -1: never
+			int stopToken = -1;
+		};
+		// Autoregressive decoding on a sequence graph: input [B, T, 1] token ids or [B, T, V] one-hot,
+		// output [B, T, V] logits or probabilities. Each token is sampled from the last position and fed
+		// back as the next input; returns the new tokens only
+		std::vector<int> generate(const std::vector<int> &prompt, const GenerateOptions &options);
+		static std::vector<int> generate(GraphRuntime &graph, const std::vector<int> &prompt, const GenerateOptions &options);
+		// True when no op up to the output mixes time steps: a position's output depends on its own
+		// input only, so generate() forwards the newest token alone instead of re-running the window
+		static bool decodesIncrementally(const GraphRuntime &graph);
+		// predict*() run on pooled execution contexts sharing the model weights: they are safe to
+		// call from many threads at once, as long as no training runs at the same time
+		ContextPool &contexts();
+		std::size_t sampleInputSize() const;
+		std::size_t sampleOutputSize() const;
+		// Samples per forward: predict*Batch() splits larger requests into chunks of this size
+		std::size_t maxBatchSize() const;
+		// True when the graph ends in a softmax: the output rows are already probabilities
+		bool outputIsProbability() const;
+		static bool outputIsProbability(const GraphRuntime &graph);
+		void saveBundle(const std::string &path) const;
+		// One optimization step on the batch already set in graph, returns its loss. trace, when given,
+		// receives the forward, backward and optimizer_step spans
+		static Scalar trainStep(GraphRuntime &graph, Optimizers::Optimizer &optimizer, TraceRecorder *trace = nullptr);
+		// {"name": "Adam" | "Fixed", "params": {...}}, as under the config "optimizer" key
+		static std::unique_ptr<Optimizers::Optimizer> createOptimizer(const json &optimizerDef);
+		// Weights, optimizer moments, dataset order/RNG and counters: train() continues from the
+		// saved batch with the same batches it would have seen
+		void loadTrainingState(const std::string &path);
 
 	private:
 		std::string graphPath_;
 		std::string weightsPath_;
 		std::unique_ptr<Optimizers::Optimizer> optimizer_;
-		std::optional<StreamFileDataset> trainDataset_;
-		std::optional<StreamFileDataset> valDataset_;
+		std::unique_ptr<Dataset> trainDataset_;
+		std::unique_ptr<Dataset> valDataset_;
 		std::optional<TrainValidateDataset> trainValDataset_;
 		std::optional<GraphRuntime> graphRuntime_;
+		std::unique_ptr<ContextPool> contexts_;
+		// "trace_path": Chrome / Perfetto timeline of train(), flushed at the end of each epoch
+		std::unique_ptr<TraceRecorder> trace_;
 		std::string outputPath_;
+		std::string checkpointPath_;
+		int checkpointEveryXBatch_ = 0;
+		CheckpointWriter::Sync checkpointSync_ = CheckpointWriter::Sync::File;
+		std::string statePath_;
+		int stateEveryXBatch_ = 0;
+		bool resumed_ = false;
+		int resumeEpoch_ = 0;
+		std::size_t resumeBatch_ = 0;
+		Scalar resumeBestLoss_{};
 		int epochsNumber_{};
 		int logOnEachXBatch_ = 1;
 		
-		static json loadJson(const std::string &path);
-		void loadGraphRuntime(const json &configDef);
+		// Runs n samples through graph in chunks of at most the max batch size, handing each chunk's
+		// output rows to sink while they are still in the output tensor
+		static void forEachOutputChunk(
+			GraphRuntime &graph,
+			const Scalar *x,
+			std::size_t n,
+			const std::function<void(std::size_t first, std::size_t rows, const Scalar *output)> &sink);
+		static std::vector<std::string> loadDatasetPaths(const json &pathDef);
+		void loadGraphRuntime(const json &configDef, TensorDataMap graphData);
 		void loadOptimizer(const json &configDef);
 		void loadTrainValidateDataset(const json &configDef);
+		void loadTokenStreamDataset(const json &configDef);
+		void loadShmRingDataset(const json &configDef);
 		void loadOutputPath(const json &configDef);
+		void loadCheckpointPolicy(const json &configDef);
+		void loadStatePolicy(const json &configDef);
+		void serializeTrainingState(std::string &out, int epoch, std::size_t batch, Scalar bestLoss) const;
 		void loadEpochsNumber(const json &configDef);
 	};
 }
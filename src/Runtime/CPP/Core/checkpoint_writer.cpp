@@ -0,0 +1,216 @@
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "checkpoint_writer.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	namespace
+	{
+		void fsyncPath(const std::string &path, int flags)
+		{
+			const int fd = ::open(path.c_str(), flags);
+			if (fd < 0)
+				throw std::runtime_error("Unable to open for fsync: " + path);
+
+			const int rc = ::fsync(fd);
+			::close(fd);
+
+			if (rc != 0)
+				throw std::runtime_error("fsync failed: " + path);
+		}
+	}
+
+	CheckpointWriter::CheckpointWriter(Sync sync, TraceRecorder *trace)
+		: sync_(sync), trace_(trace)
+	{
+		worker_ = std::thread(&CheckpointWriter::run_, this);
+	}
+
+	CheckpointWriter::~CheckpointWriter()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		cv_.notify_all();
+		worker_.join();
+
+		if (!error_.empty())
+			std::cerr << "Checkpoint write failed: " << error_ << "\n";
+	}
+
+	void CheckpointWriter::submit(const GraphRuntime &graph, const std::string &path)
+	{
+		const int slot = acquire_(path);
+
+		// The slot is neither pending nor being written: copy without holding the lock
+		const auto weights = graph.trainableTensors();
+		auto &snapshot = buffers_[slot];
+		snapshot.path = path;
+		snapshot.raw = false;
+		snapshot.tensors.resize(weights.size());
+
+		for (std::size_t i = 0; i < weights.size(); ++i)
+		{
+			auto &dst = snapshot.tensors[i];
+			dst.id = weights[i]->id;
+			dst.shape = weights[i]->shape;
+			dst.data.assign(weights[i]->data.begin(), weights[i]->data.end());
+		}
+
+		publish_(slot);
+	}
+
+	void CheckpointWriter::submitBytes(const std::string &path, std::string &bytes)
+	{
+		const int slot = acquire_(path);
+
+		auto &snapshot = buffers_[slot];
+		snapshot.path = path;
+		snapshot.raw = true;
+		snapshot.bytes.swap(bytes);
+		bytes.clear();
+
+		publish_(slot);
+	}
+
+	int CheckpointWriter::acquire_(const std::string &path)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		throwError_();
+
+		// A pending snapshot for another path (best weights vs periodic) must reach the disk first
+		cv_.wait(lock, [&] { return pending_ < 0 || buffers_[pending_].path == path; });
+
+		if (pending_ >= 0)
+		{
+			const int slot = pending_;
+			pending_ = -1;
+			return slot;
+		}
+
+		return writing_ == 0 ? 1 : 0;
+	}
+
+	void CheckpointWriter::publish_(int slot)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			pending_ = slot;
+		}
+		cv_.notify_all();
+	}
+
+	void CheckpointWriter::flush()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_.wait(lock, [&] { return pending_ < 0 && writing_ < 0; });
+		throwError_();
+	}
+
+	CheckpointWriter::Sync CheckpointWriter::parseSync(const std::string &name)
+	{
+		if (name == "none")
+			return Sync::None;
+		if (name == "file")
+			return Sync::File;
+		if (name == "full")
+			return Sync::Full;
+
+		throw std::runtime_error("Unknown checkpoint fsync policy: " + name);
+	}
+
+	void CheckpointWriter::run_()
+	{
+		if (trace_)
+			trace_->nameThread("checkpoint writer");
+
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		for (;;)
+		{
+			cv_.wait(lock, [&] { return stop_ || pending_ >= 0; });
+
+			if (pending_ < 0)
+				return;
+
+			writing_ = pending_;
+			pending_ = -1;
+			lock.unlock();
+
+			std::string error;
+			try
+			{
+				TraceRecorder::Span span(trace_, "checkpoint_write", "io");
+				write_(buffers_[writing_]);
+			}
+			catch (const std::exception &e)
+			{
+				error = e.what();
+			}
+
+			lock.lock();
+			if (!error.empty() && error_.empty())
+				error_ = error;
+			writing_ = -1;
+			cv_.notify_all();
+		}
+	}
+
+	void CheckpointWriter::write_(const Snapshot &snapshot) const
+	{
+		// The only temp file and rename of a checkpoint: the weights writers only fill the stream
+		const auto tmpPath = snapshot.path + ".tmp";
+
+		{
+			std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				throw std::runtime_error("Unable to open file for writing: " + tmpPath);
+
+			if (snapshot.raw)
+				file.write(snapshot.bytes.data(), static_cast<std::streamsize>(snapshot.bytes.size()));
+			else
+			{
+				std::vector<const Tensor *> weights;
+				weights.reserve(snapshot.tensors.size());
+				for (const auto &t : snapshot.tensors)
+					weights.push_back(&t);
+
+				GraphRuntime::writeWeights(file, weights, GraphRuntime::isBinaryWeightsPath(snapshot.path));
+			}
+
+			file.close();
+			if (!file)
+				throw std::runtime_error("Unable to write checkpoint: " + tmpPath);
+		}
+
+		if (sync_ != Sync::None)
+			fsyncPath(tmpPath, O_RDONLY);
+
+		if (std::rename(tmpPath.c_str(), snapshot.path.c_str()) != 0)
+			throw std::runtime_error("Unable to rename checkpoint: " + tmpPath);
+
+		if (sync_ == Sync::Full)
+		{
+			const auto slash = snapshot.path.find_last_of('/');
+			const auto dir = slash == std::string::npos ? std::string(".") : slash == 0 ? std::string("/") : snapshot.path.substr(0, slash);
+			fsyncPath(dir, O_RDONLY | O_DIRECTORY);
+		}
+	}
+
+	void CheckpointWriter::throwError_()
+	{
+		if (error_.empty())
+			return;
+
+		const auto message = error_;
+		error_.clear();
+		throw std::runtime_error("Checkpoint write failed: " + message);
+	}
+}
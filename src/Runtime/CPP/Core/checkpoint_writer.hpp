@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "runtime.hpp"
+#include "trace_recorder.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Background weights writer. submit() copies the trainable tensors into one of two snapshot
+	// buffers and returns; a worker thread serializes the other buffer to "<path>.tmp", syncs it
+	// according to the policy and renames it over the destination, so readers only ever see a
+	// complete file. A pending snapshot for the same path is replaced by a newer one.
+	class CheckpointWriter
+	{
+	public:
+		enum class Sync
+		{
+			None,       // rename only: fastest, the file may be lost on power failure
+			File,       // fsync the data before the rename
+			Full        // fsync the data and the parent directory after the rename
+		};
+
+		// trace, when given, receives a checkpoint_write span per file from the worker thread
+		explicit CheckpointWriter(Sync sync = Sync::File, TraceRecorder *trace = nullptr);
+		~CheckpointWriter();
+
+		CheckpointWriter(const CheckpointWriter &) = delete;
+		CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+		void submit(const GraphRuntime &graph, const std::string &path);
+		// Already serialized content (training state): bytes is swapped with the free buffer
+		void submitBytes(const std::string &path, std::string &bytes);
+		// Waits for every submitted snapshot; rethrows the first write error
+		void flush();
+
+		static Sync parseSync(const std::string &name);
+
+	private:
+		struct Snapshot
+		{
+			std::string path;
+			std::vector<Tensor> tensors;
+			std::string bytes;
+			bool raw = false;
+		};
+
+		Sync sync_;
+		TraceRecorder *trace_;
+		Snapshot buffers_[2];
+		int pending_ = -1;
+		int writing_ = -1;
+		bool stop_ = false;
+		std::string error_;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::thread worker_;
+
+		int acquire_(const std::string &path);
+		void publish_(int slot);
+		void run_();
+		void write_(const Snapshot &snapshot) const;
+		void throwError_();
+	};
+}
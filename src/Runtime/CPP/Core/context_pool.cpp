@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include "context_pool.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	ContextPool::Lease::Lease(ContextPool *pool, std::size_t slot, GraphRuntime *graph)
+		: pool_(pool), slot_(slot), graph_(graph)
+	{
+	}
+
+	ContextPool::Lease::~Lease()
+	{
+		release();
+	}
+
+	ContextPool::Lease::Lease(Lease &&other) noexcept
+		: pool_(std::exchange(other.pool_, nullptr)), slot_(other.slot_), graph_(std::exchange(other.graph_, nullptr))
+	{
+	}
+
+	ContextPool::Lease &ContextPool::Lease::operator=(Lease &&other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			pool_ = std::exchange(other.pool_, nullptr);
+			slot_ = other.slot_;
+			graph_ = std::exchange(other.graph_, nullptr);
+		}
+		return *this;
+	}
+
+	GraphRuntime &ContextPool::Lease::graph() const
+	{
+		if (graph_ == nullptr)
+			throw std::runtime_error("No execution context leased");
+
+		return *graph_;
+	}
+
+	bool ContextPool::Lease::valid() const
+	{
+		return graph_ != nullptr;
+	}
+
+	void ContextPool::Lease::release()
+	{
+		if (pool_ != nullptr)
+			pool_->release_(slot_);
+
+		pool_ = nullptr;
+		graph_ = nullptr;
+	}
+
+	ContextPool::ContextPool(const GraphRuntime &model, std::size_t capacity)
+		: model_(model),
+		capacity_(capacity > 0 ? capacity : std::max(1u, std::thread::hardware_concurrency())),
+		slots_(new Slot_[capacity_])
+	{
+	}
+
+	ContextPool::Lease ContextPool::acquire()
+	{
+		// Leases are short (one forward): a few yields usually see a slot come back
+		for (int spin = 0; spin < 64; ++spin)
+		{
+			auto lease = tryAcquire();
+			if (lease.valid())
+				return lease;
+
+			std::this_thread::yield();
+		}
+
+		std::unique_lock<std::mutex> lock(waitMutex_);
+		waiters_.fetch_add(1);
+
+		try
+		{
+			for (;;)
+			{
+				// Pairs with the fence in release_(): either this probe sees the free slot or the releaser sees the waiter
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				auto lease = tryAcquire();
+				if (lease.valid())
+				{
+					waiters_.fetch_sub(1);
+					return lease;
+				}
+
+				released_.wait(lock);
+			}
+		}
+		catch (...)
+		{
+			waiters_.fetch_sub(1);
+			throw;
+		}
+	}
+
+	ContextPool::Lease ContextPool::tryAcquire()
+	{
+		// Rotating start: concurrent callers probe different slots first
+		const auto start = next_.fetch_add(1, std::memory_order_relaxed);
+
+		for (std::size_t i = 0; i < capacity_; ++i)
+		{
+			const auto slot = (start + i) % capacity_;
+			auto &s = slots_[slot];
+
+			if (s.busy.load(std::memory_order_relaxed) || s.busy.exchange(true, std::memory_order_acquire))
+				continue;
+
+			// Only the holder of the slot touches its context
+			if (!s.context)
+			{
+				try
+				{
+					s.context = model_.createContext();
+				}
+				catch (...)
+				{
+					s.busy.store(false, std::memory_order_release);
+					throw;
+				}
+			}
+
+			return Lease(this, slot, s.context.get());
+		}
+
+		return Lease();
+	}
+
+	std::size_t ContextPool::capacity() const
+	{
+		return capacity_;
+	}
+
+	void ContextPool::release_(std::size_t slot)
+	{
+		slots_[slot].busy.store(false, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (waiters_.load(std::memory_order_relaxed) == 0)
+			return;
+
+		// Taking the mutex orders the notify after a waiter's probe: it is already waiting or will see the slot
+		{
+			std::lock_guard<std::mutex> lock(waitMutex_);
+		}
+		released_.notify_one();
+	}
+}
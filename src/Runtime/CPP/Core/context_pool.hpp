@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include "runtime.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Fixed set of execution contexts over one shared model. Each slot is claimed with a single
+	// atomic exchange, no mutex: when every slot is busy acquire() spins briefly, then sleeps on a
+	// condition variable until a lease is released. Contexts are created on the first claim of
+	// their slot and live as long as the pool.
+	class ContextPool
+	{
+	public:
+		class Lease
+		{
+		public:
+			Lease() = default;
+			Lease(ContextPool *pool, std::size_t slot, GraphRuntime *graph);
+			~Lease();
+
+			Lease(Lease &&other) noexcept;
+			Lease &operator=(Lease &&other) noexcept;
+			Lease(const Lease &) = delete;
+			Lease &operator=(const Lease &) = delete;
+
+			GraphRuntime &graph() const;
+			bool valid() const;
+			void release();
+
+		private:
+			ContextPool *pool_ = nullptr;
+			std::size_t slot_ = 0;
+			GraphRuntime *graph_ = nullptr;
+		};
+
+		// capacity 0: one slot per hardware thread
+		explicit ContextPool(const GraphRuntime &model, std::size_t capacity = 0);
+
+		ContextPool(const ContextPool &) = delete;
+		ContextPool &operator=(const ContextPool &) = delete;
+
+		Lease acquire();
+		// Empty lease (graph() throws) when every slot is busy
+		Lease tryAcquire();
+		std::size_t capacity() const;
+
+	private:
+		struct alignas(64) Slot_
+		{
+			std::atomic<bool> busy{false};
+			std::unique_ptr<GraphRuntime> context;
+		};
+
+		const GraphRuntime &model_;
+		std::size_t capacity_;
+		std::unique_ptr<Slot_[]> slots_;
+		std::atomic<std::size_t> next_{0};
+
+		// Only touched once the short spin fails: releases skip the mutex while nobody sleeps
+		std::mutex waitMutex_;
+		std::condition_variable released_;
+		std::atomic<std::size_t> waiters_{0};
+
+		void release_(std::size_t slot);
+	};
+}
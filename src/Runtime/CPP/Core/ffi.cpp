@@ -1,14 +1,23 @@
 #include "ffi.hpp"
+#include <algorithm>
+#include <memory>
 #include <new>
 #include <string>
 #include <vector>
 #include "Core.hpp"
+#include "model_bundle.hpp"
 #include "runtime.hpp"
+#include "../Dataset/shm_ring.hpp"
 
+using PHP2xAI::Runtime::CPP::ContextPool;
 using PHP2xAI::Runtime::CPP::Core;
 using PHP2xAI::Runtime::CPP::GraphRuntime;
+using PHP2xAI::Runtime::CPP::JsonLoader;
+using PHP2xAI::Runtime::CPP::ModelBundle;
+using PHP2xAI::Runtime::CPP::Optimizers::Optimizer;
 using PHP2xAI::Runtime::CPP::Scalar;
 using PHP2xAI::Runtime::CPP::json;
+using PHP2xAI::Runtime::CPP::ShmRing;
 
 struct PHP2xAI_Core
 {
@@ -19,6 +28,18 @@ struct PHP2xAI_Runtime
 {
 	GraphRuntime *runtime = nullptr;
 	std::vector<int> shapeBuffer;
+	std::unique_ptr<Optimizer> optimizer;
+	std::string profileBuffer;
+};
+
+struct PHP2xAI_Ring
+{
+	ShmRing *ring = nullptr;
+};
+
+struct PHP2xAI_Context
+{
+	ContextPool::Lease lease;
 };
 
 extern "C" {
@@ -36,6 +57,39 @@ extern "C" {
 		}
 	}
 
+	PHP2xAI_Core* php2xai_core_create_from_bundle(const char* bundle_path)
+	{
+		if (!bundle_path)
+			return nullptr;
+		try
+		{
+			// Params stay in the bundle mapping: workers loading the same file share its pages
+			auto *core = new Core(std::make_shared<const ModelBundle>(bundle_path));
+			auto *handle = new PHP2xAI_Core();
+			handle->core = core;
+			return handle;
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+
+	int php2xai_core_save_bundle(PHP2xAI_Core* core, const char* bundle_path)
+	{
+		if (!core || !core->core || !bundle_path)
+			return 1;
+		try
+		{
+			core->core->saveBundle(bundle_path);
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
 	void php2xai_core_destroy(PHP2xAI_Core* core)
 	{
 		if (!core)
@@ -128,6 +182,210 @@ extern "C" {
 		return 0;
 	}
 
+	std::size_t php2xai_core_sample_input_size(PHP2xAI_Core* core)
+	{
+		if (!core || !core->core)
+			return 0;
+		try
+		{
+			return core->core->sampleInputSize();
+		}
+		catch (...)
+		{
+			return 0;
+		}
+	}
+
+	std::size_t php2xai_core_sample_output_size(PHP2xAI_Core* core)
+	{
+		if (!core || !core->core)
+			return 0;
+		try
+		{
+			return core->core->sampleOutputSize();
+		}
+		catch (...)
+		{
+			return 0;
+		}
+	}
+
+	int php2xai_core_predict_batch(
+		PHP2xAI_Core* core,
+		const float* x,
+		std::size_t n,
+		float* out)
+	{
+		if (!core || !core->core || (n > 0 && (!x || !out)))
+			return 1;
+		try
+		{
+			core->core->predictBatch(x, n, out);
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
+	int php2xai_core_predict_label_int_batch(
+		PHP2xAI_Core* core,
+		const float* x,
+		std::size_t n,
+		int* out_labels)
+	{
+		if (!core || !core->core || (n > 0 && (!x || !out_labels)))
+			return 1;
+		try
+		{
+			core->core->predictLabelIntBatch(x, n, out_labels);
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
+	int php2xai_core_predict_topk(
+		PHP2xAI_Core* core,
+		const float* x,
+		std::size_t k,
+		int* out_ids,
+		float* out_scores)
+	{
+		return php2xai_core_predict_topk_batch(core, x, 1, k, out_ids, out_scores);
+	}
+
+	int php2xai_core_predict_topk_batch(
+		PHP2xAI_Core* core,
+		const float* x,
+		std::size_t n,
+		std::size_t k,
+		int* out_ids,
+		float* out_scores)
+	{
+		if (!core || !core->core || (n > 0 && k > 0 && (!x || !out_ids || !out_scores)))
+			return 1;
+		try
+		{
+			core->core->predictTopKBatch(x, n, k, out_ids, out_scores);
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
+	int php2xai_core_generate(
+		PHP2xAI_Core* core,
+		const int* prompt,
+		std::size_t prompt_len,
+		std::size_t max_new_tokens,
+		std::size_t top_k,
+		float temperature,
+		uint64_t seed,
+		int stop_token,
+		int* out_tokens,
+		std::size_t* out_len)
+	{
+		if (!core || !core->core || !prompt || prompt_len == 0 || !out_len || (max_new_tokens > 0 && !out_tokens))
+			return 1;
+		try
+		{
+			Core::GenerateOptions options;
+			options.maxNewTokens = max_new_tokens;
+			options.topK = top_k;
+			options.temperature = temperature;
+			options.seed = seed;
+			options.stopToken = stop_token;
+
+			const auto tokens = core->core->generate(std::vector<int>(prompt, prompt + prompt_len), options);
+
+			std::copy(tokens.begin(), tokens.end(), out_tokens);
+			*out_len = tokens.size();
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
+	std::size_t php2xai_core_context_capacity(PHP2xAI_Core* core)
+	{
+		if (!core || !core->core)
+			return 0;
+		try
+		{
+			return core->core->contexts().capacity();
+		}
+		catch (...)
+		{
+			return 0;
+		}
+	}
+
+	PHP2xAI_Context* php2xai_core_context_acquire(PHP2xAI_Core* core)
+	{
+		if (!core || !core->core)
+			return nullptr;
+		try
+		{
+			auto lease = core->core->contexts().acquire();
+			return new PHP2xAI_Context{std::move(lease)};
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+
+	void php2xai_context_release(PHP2xAI_Context* context)
+	{
+		delete context;
+	}
+
+	int php2xai_context_predict_batch(
+		PHP2xAI_Context* context,
+		const float* x,
+		std::size_t n,
+		float* out)
+	{
+		if (!context || !context->lease.valid() || (n > 0 && (!x || !out)))
+			return 1;
+		try
+		{
+			Core::predictBatch(context->lease.graph(), x, n, out);
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
+	int php2xai_context_predict_label_int_batch(
+		PHP2xAI_Context* context,
+		const float* x,
+		std::size_t n,
+		int* out_labels)
+	{
+		if (!context || !context->lease.valid() || (n > 0 && (!x || !out_labels)))
+			return 1;
+		try
+		{
+			Core::predictLabelIntBatch(context->lease.graph(), x, n, out_labels);
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
 	PHP2xAI_Runtime* php2xai_runtime_create(const char* graph_json)
 	{
 		if (!graph_json)
@@ -135,8 +393,8 @@ extern "C" {
 		try
 		{
 			auto *handle = new PHP2xAI_Runtime();
-			json graphDef = json::parse(std::string(graph_json));
-			handle->runtime = new GraphRuntime(graphDef, "");
+			auto graph = JsonLoader::parse(std::string(graph_json));
+			handle->runtime = new GraphRuntime(graph.doc, "", std::move(graph.tensorData));
 			return handle;
 		}
 		catch (...)
@@ -245,4 +503,244 @@ extern "C" {
 		}
 		return 0;
 	}
+
+	float* php2xai_runtime_tensor_data_ptr(PHP2xAI_Runtime* runtime, int id, std::size_t* out_len)
+	{
+		if (out_len)
+			*out_len = 0;
+		if (!runtime || !runtime->runtime || !out_len)
+			return nullptr;
+		try
+		{
+			auto &tensor = runtime->runtime->getTensor(id);
+			*out_len = tensor.data.size();
+			return tensor.data.data();
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+
+	float* php2xai_runtime_tensor_grad_ptr(PHP2xAI_Runtime* runtime, int id, std::size_t* out_len)
+	{
+		if (out_len)
+			*out_len = 0;
+		if (!runtime || !runtime->runtime || !out_len)
+			return nullptr;
+		try
+		{
+			auto &tensor = runtime->runtime->getTensor(id);
+			*out_len = tensor.grad.size();
+			return tensor.grad.data();
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+
+	int php2xai_runtime_write_tensor_data(
+		PHP2xAI_Runtime* runtime,
+		int id,
+		std::size_t offset,
+		const float* x,
+		std::size_t n)
+	{
+		if (!runtime || !runtime->runtime || (n > 0 && !x))
+			return 1;
+		try
+		{
+			auto &tensor = runtime->runtime->getTensor(id);
+			if (offset > tensor.data.size() || n > tensor.data.size() - offset)
+				return 3;
+			std::copy(x, x + n, tensor.data.begin() + offset);
+		}
+		catch (...)
+		{
+			return 4;
+		}
+		return 0;
+	}
+
+	int php2xai_runtime_set_tensor_data(PHP2xAI_Runtime* runtime, int id, const float* x, std::size_t n)
+	{
+		if (!runtime || !runtime->runtime || (n > 0 && !x))
+			return 1;
+		try
+		{
+			runtime->runtime->setTensorData(id, x, n);
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
+	int php2xai_runtime_set_optimizer(PHP2xAI_Runtime* runtime, const char* optimizer_json)
+	{
+		if (!runtime || !runtime->runtime || !optimizer_json)
+			return 1;
+		try
+		{
+			runtime->optimizer = Core::createOptimizer(json::parse(optimizer_json));
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
+	int php2xai_runtime_train_step(
+		PHP2xAI_Runtime* runtime,
+		const float* x,
+		std::size_t x_len,
+		const float* y,
+		std::size_t y_len,
+		float* out_loss)
+	{
+		if (!runtime || !runtime->runtime || !x || !y || !out_loss)
+			return 1;
+		if (!runtime->optimizer)
+			return 4;
+		try
+		{
+			auto &graph = *runtime->runtime;
+
+			// Checked before either write: a mismatched y must not leave the input resized
+			if (graph.getTensor(graph.inputId).batched && graph.getTensor(graph.targetId).batched)
+			{
+				const auto xSample = graph.sampleSize(graph.inputId);
+				const auto ySample = graph.sampleSize(graph.targetId);
+
+				if (xSample == 0 || ySample == 0 || x_len % xSample != 0 || y_len % ySample != 0
+					|| x_len / xSample != y_len / ySample)
+					return 3;
+			}
+
+			graph.setTensorData(graph.inputId, x, x_len);
+			graph.setTensorData(graph.targetId, y, y_len);
+			*out_loss = Core::trainStep(graph, *runtime->optimizer);
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
+	int php2xai_runtime_set_profiling(PHP2xAI_Runtime* runtime, int enabled)
+	{
+		if (!runtime || !runtime->runtime)
+			return 1;
+		try
+		{
+			runtime->runtime->setProfiling(enabled != 0);
+		}
+		catch (...)
+		{
+			return 2;
+		}
+		return 0;
+	}
+
+	int php2xai_runtime_reset_profile(PHP2xAI_Runtime* runtime)
+	{
+		if (!runtime || !runtime->runtime)
+			return 1;
+		runtime->runtime->resetProfile();
+		return 0;
+	}
+
+	const char* php2xai_runtime_get_profile(PHP2xAI_Runtime* runtime)
+	{
+		if (!runtime || !runtime->runtime)
+			return nullptr;
+		try
+		{
+			const auto *profile = runtime->runtime->profile();
+			json doc = profile ? profile->toJson() : json{{"ops", json::array()}, {"kernels", json::object()}};
+			doc["enabled"] = runtime->runtime->isProfiling();
+
+			runtime->profileBuffer = doc.dump();
+			return runtime->profileBuffer.c_str();
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+
+	PHP2xAI_Ring* php2xai_ring_create(const char* name, std::size_t slots, std::size_t slot_floats)
+	{
+		if (!name)
+			return nullptr;
+		try
+		{
+			auto *handle = new PHP2xAI_Ring();
+			handle->ring = new ShmRing(name, slots, slot_floats);
+			return handle;
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+
+	void php2xai_ring_destroy(PHP2xAI_Ring* ring)
+	{
+		if (!ring)
+			return;
+		delete ring->ring;
+		ring->ring = nullptr;
+		delete ring;
+	}
+
+	int php2xai_ring_push(
+		PHP2xAI_Ring* ring,
+		const float* x,
+		std::size_t x_len,
+		const float* y,
+		std::size_t y_len,
+		int timeout_ms)
+	{
+		if (!ring || !ring->ring || (!x && x_len > 0) || (!y && y_len > 0))
+			return 1;
+		try
+		{
+			if (!ring->ring->push(x, x_len, y, y_len, timeout_ms))
+				return 2;
+		}
+		catch (...)
+		{
+			return 3;
+		}
+		return 0;
+	}
+
+	int php2xai_ring_end_epoch(PHP2xAI_Ring* ring, int timeout_ms)
+	{
+		if (!ring || !ring->ring)
+			return 1;
+		try
+		{
+			if (!ring->ring->endEpoch(timeout_ms))
+				return 2;
+		}
+		catch (...)
+		{
+			return 3;
+		}
+		return 0;
+	}
+
+	int php2xai_ring_close(PHP2xAI_Ring* ring)
+	{
+		if (!ring || !ring->ring)
+			return 1;
+		ring->ring->close();
+		return 0;
+	}
 }
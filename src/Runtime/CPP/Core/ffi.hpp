@@ -1,12 +1,17 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
 extern "C" {
 	struct PHP2xAI_Core;
 	struct PHP2xAI_Runtime;
+	struct PHP2xAI_Ring;
+	struct PHP2xAI_Context;
 
 	PHP2xAI_Core* php2xai_core_create(const char* model_path, const char* weights_path);
+	PHP2xAI_Core* php2xai_core_create_from_bundle(const char* bundle_path);
+	int php2xai_core_save_bundle(PHP2xAI_Core* core, const char* bundle_path);
 	void php2xai_core_destroy(PHP2xAI_Core* core);
 
 	std::size_t php2xai_core_input_size(PHP2xAI_Core* core);
@@ -25,6 +30,65 @@ extern "C" {
 		std::size_t x_len,
 		int* out_label);
 
+	// n samples of php2xai_core_sample_input_size() floats each; out holds n * sample_output_size
+	std::size_t php2xai_core_sample_input_size(PHP2xAI_Core* core);
+	std::size_t php2xai_core_sample_output_size(PHP2xAI_Core* core);
+	int php2xai_core_predict_batch(
+		PHP2xAI_Core* core,
+		const float* x,
+		std::size_t n,
+		float* out);
+	int php2xai_core_predict_label_int_batch(
+		PHP2xAI_Core* core,
+		const float* x,
+		std::size_t n,
+		int* out_labels);
+	// k best classes per sample, best first, with softmax probabilities: out_ids/out_scores hold
+	// n * k entries, padded with id -1 when the output has fewer than k classes
+	int php2xai_core_predict_topk(
+		PHP2xAI_Core* core,
+		const float* x,
+		std::size_t k,
+		int* out_ids,
+		float* out_scores);
+	int php2xai_core_predict_topk_batch(
+		PHP2xAI_Core* core,
+		const float* x,
+		std::size_t n,
+		std::size_t k,
+		int* out_ids,
+		float* out_scores);
+	// Autoregressive decoding from prompt (token ids), see Core::generate: writes at most
+	// max_new_tokens ids to out_tokens and their count to out_len. top_k 0: whole vocabulary,
+	// temperature 0: greedy, seed 0: random, stop_token -1: none
+	int php2xai_core_generate(
+		PHP2xAI_Core* core,
+		const int* prompt,
+		std::size_t prompt_len,
+		std::size_t max_new_tokens,
+		std::size_t top_k,
+		float temperature,
+		uint64_t seed,
+		int stop_token,
+		int* out_tokens,
+		std::size_t* out_len);
+
+	// Execution contexts share the core's weights: one per concurrent caller, reused across calls.
+	// acquire waits while all php2xai_core_context_capacity() contexts are leased
+	std::size_t php2xai_core_context_capacity(PHP2xAI_Core* core);
+	PHP2xAI_Context* php2xai_core_context_acquire(PHP2xAI_Core* core);
+	void php2xai_context_release(PHP2xAI_Context* context);
+	int php2xai_context_predict_batch(
+		PHP2xAI_Context* context,
+		const float* x,
+		std::size_t n,
+		float* out);
+	int php2xai_context_predict_label_int_batch(
+		PHP2xAI_Context* context,
+		const float* x,
+		std::size_t n,
+		int* out_labels);
+
 	PHP2xAI_Runtime* php2xai_runtime_create(const char* graph_json);
 	void php2xai_runtime_destroy(PHP2xAI_Runtime* runtime);
 	int php2xai_runtime_forward(PHP2xAI_Runtime* runtime);
@@ -32,4 +96,48 @@ extern "C" {
 	int* php2xai_runtime_get_tensor_shape(PHP2xAI_Runtime* runtime, int id);
 	int php2xai_runtime_get_tensor_data(PHP2xAI_Runtime* runtime, int id, float* out, int n);
 	int php2xai_runtime_get_tensor_grad(PHP2xAI_Runtime* runtime, int id, float* out, int n);
+
+	// In-place access, no copy. Kernels write into the existing storage, so once forward() and
+	// backward() have run the pointer survives further calls to them; fetch it again after anything
+	// that resizes the tensor (batch size or sequence length change). nullptr and *out_len = 0 on error
+	float* php2xai_runtime_tensor_data_ptr(PHP2xAI_Runtime* runtime, int id, std::size_t* out_len);
+	float* php2xai_runtime_tensor_grad_ptr(PHP2xAI_Runtime* runtime, int id, std::size_t* out_len);
+	// Copies n floats into the tensor data starting at element offset
+	int php2xai_runtime_write_tensor_data(
+		PHP2xAI_Runtime* runtime,
+		int id,
+		std::size_t offset,
+		const float* x,
+		std::size_t n);
+
+	// Whole tensor, batched tensors of another size switch the batch size (input, target)
+	int php2xai_runtime_set_tensor_data(PHP2xAI_Runtime* runtime, int id, const float* x, std::size_t n);
+	// Same JSON as the config "optimizer" key: {"name": "Adam", "params": {"learningRate": 0.01}}
+	int php2xai_runtime_set_optimizer(PHP2xAI_Runtime* runtime, const char* optimizer_json);
+	// Sets input and target, runs forward, backward and one optimizer step.
+	// 3: x and y hold different batch sizes (neither tensor is touched), 4: no optimizer set
+	int php2xai_runtime_train_step(
+		PHP2xAI_Runtime* runtime,
+		const float* x,
+		std::size_t x_len,
+		const float* y,
+		std::size_t y_len,
+		float* out_loss);
+	// Per-op timings of forward/backward, see GraphRuntime::setProfiling. get_profile returns the
+	// OpProfiler JSON plus "enabled", owned by the runtime and valid until the next call
+	int php2xai_runtime_set_profiling(PHP2xAI_Runtime* runtime, int enabled);
+	int php2xai_runtime_reset_profile(PHP2xAI_Runtime* runtime);
+	const char* php2xai_runtime_get_profile(PHP2xAI_Runtime* runtime);
+
+	PHP2xAI_Ring* php2xai_ring_create(const char* name, std::size_t slots, std::size_t slot_floats);
+	void php2xai_ring_destroy(PHP2xAI_Ring* ring);
+	int php2xai_ring_push(
+		PHP2xAI_Ring* ring,
+		const float* x,
+		std::size_t x_len,
+		const float* y,
+		std::size_t y_len,
+		int timeout_ms);
+	int php2xai_ring_end_epoch(PHP2xAI_Ring* ring, int timeout_ms);
+	int php2xai_ring_close(PHP2xAI_Ring* ring);
 }
@@ -0,0 +1,482 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "inference_server.hpp"
+#include "json_loader.hpp"
+#include "model_bundle.hpp"
+#include "../Utility/Utility.hpp"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	#error "The inference protocol is little-endian: big-endian hosts are not supported"
+#endif
+
+namespace PHP2xAI::Runtime::CPP
+{
+	namespace
+	{
+		constexpr char RequestMagic[4] = {'P', '2', 'X', 'Q'};
+		constexpr char ResponseMagic[4] = {'P', '2', 'X', 'R'};
+		constexpr std::size_t MaxNameBytes = 256;
+		constexpr std::size_t MaxRequestBytes = std::size_t(256) << 20;
+
+		struct RequestHeader
+		{
+			char magic[4];
+			uint32_t op;
+			uint32_t nameBytes;
+			uint32_t samples;
+			uint32_t k;
+		};
+
+		struct ResponseHeader
+		{
+			char magic[4];
+			int32_t status;
+			uint32_t payloadBytes;
+		};
+
+		enum Status : int32_t
+		{
+			Ok = 0,
+			BadRequest = 1,
+			UnknownModel = 2,
+			Failed = 3,
+			ShuttingDown = 4
+		};
+
+		bool readFully(int fd, void *buffer, std::size_t bytes)
+		{
+			auto *p = static_cast<char *>(buffer);
+
+			while (bytes > 0)
+			{
+				const auto n = ::read(fd, p, bytes);
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					return false;
+
+				p += n;
+				bytes -= static_cast<std::size_t>(n);
+			}
+
+			return true;
+		}
+
+		bool writeFully(int fd, const void *buffer, std::size_t bytes)
+		{
+			const auto *p = static_cast<const char *>(buffer);
+
+			while (bytes > 0)
+			{
+				const auto n = ::send(fd, p, bytes, MSG_NOSIGNAL);
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					return false;
+
+				p += n;
+				bytes -= static_cast<std::size_t>(n);
+			}
+
+			return true;
+		}
+
+		bool respond(int fd, int32_t status, const std::string &payload)
+		{
+			ResponseHeader header{};
+			std::memcpy(header.magic, ResponseMagic, sizeof(ResponseMagic));
+			header.status = status;
+			header.payloadBytes = static_cast<uint32_t>(payload.size());
+
+			return writeFully(fd, &header, sizeof(header)) && writeFully(fd, payload.data(), payload.size());
+		}
+
+		template <typename T>
+		void append(std::string &out, const T *values, std::size_t count)
+		{
+			out.append(reinterpret_cast<const char *>(values), count * sizeof(T));
+		}
+	}
+
+	InferenceServer::InferenceServer(Options options)
+		: options_(std::move(options))
+	{
+		if (options_.socketPath.empty())
+			throw std::runtime_error("Inference server needs a socket path");
+
+		options_.workersPerModel = std::max<std::size_t>(1, options_.workersPerModel);
+	}
+
+	InferenceServer::~InferenceServer()
+	{
+		stop();
+
+		for (auto &entry : models_)
+		{
+			auto &model = *entry.second;
+
+			{
+				std::lock_guard<std::mutex> lock(model.mutex);
+			}
+			model.ready.notify_all();
+
+			for (auto &worker : model.workers)
+			{
+				if (worker.joinable())
+					worker.join();
+			}
+		}
+
+		if (listenFd_ >= 0)
+			::close(listenFd_);
+	}
+
+	std::unique_ptr<InferenceServer> InferenceServer::fromConfig(const std::string &path)
+	{
+		const auto config = JsonLoader::load(path).doc;
+
+		Options options;
+		options.socketPath = config.at("socket").get<std::string>();
+		options.maxDelay = std::chrono::microseconds(config.value("max_delay_us", 1000));
+		options.workersPerModel = config.value("workers", std::size_t{1});
+
+		if (config.contains("socket_mode"))
+			options.socketMode = static_cast<unsigned>(std::stoul(config.at("socket_mode").get<std::string>(), nullptr, 8));
+
+		auto server = std::make_unique<InferenceServer>(options);
+
+		for (const auto &[name, modelDef] : config.at("models").items())
+		{
+			if (modelDef.contains("bundle"))
+				server->addModel(name, std::make_unique<Core>(std::make_shared<const ModelBundle>(modelDef.at("bundle").get<std::string>())));
+			else
+				server->addModel(name, std::make_unique<Core>(modelDef.at("config").get<std::string>(), modelDef.value("weights", "")));
+		}
+
+		if (server->models_.empty())
+			throw std::runtime_error("Inference server config lists no models: " + path);
+
+		return server;
+	}
+
+	void InferenceServer::addModel(const std::string &name, std::unique_ptr<Core> core)
+	{
+		if (models_.count(name) > 0)
+			throw std::runtime_error("Duplicate model name: " + name);
+
+		auto model = std::make_unique<Model_>();
+		model->sampleIn = core->sampleInputSize();
+		model->sampleOut = core->sampleOutputSize();
+		model->maxRows = core->maxBatchSize();
+		model->probabilities = core->outputIsProbability();
+		model->core = std::move(core);
+
+		auto &ref = *model;
+		models_.emplace(name, std::move(model));
+
+		for (std::size_t i = 0; i < options_.workersPerModel; ++i)
+			ref.workers.emplace_back(&InferenceServer::work_, this, std::ref(ref));
+	}
+
+	void InferenceServer::stop()
+	{
+		stopping_.store(true);
+	}
+
+	void InferenceServer::run()
+	{
+		listen_();
+
+		while (!stopping_.load())
+		{
+			pollfd pfd{listenFd_, POLLIN, 0};
+
+			// Short timeout: stop() from a signal handler is noticed without a self-pipe
+			if (::poll(&pfd, 1, 200) <= 0 || (pfd.revents & POLLIN) == 0)
+				continue;
+
+			const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+			if (fd < 0)
+				continue;
+
+			{
+				std::lock_guard<std::mutex> lock(connectionsMutex_);
+				connections_.push_back(fd);
+			}
+
+			std::thread([this, fd]
+			{
+				serve_(fd);
+
+				std::lock_guard<std::mutex> lock(connectionsMutex_);
+				connections_.erase(std::find(connections_.begin(), connections_.end(), fd));
+				::close(fd);
+				connectionsDone_.notify_all();
+			}).detach();
+		}
+
+		::close(listenFd_);
+		listenFd_ = -1;
+		::unlink(options_.socketPath.c_str());
+
+		// Wake connections blocked on a read; requests already queued are still answered
+		std::unique_lock<std::mutex> lock(connectionsMutex_);
+		for (const int fd : connections_)
+			::shutdown(fd, SHUT_RD);
+
+		connectionsDone_.wait(lock, [&] { return connections_.empty(); });
+	}
+
+	void InferenceServer::listen_()
+	{
+		sockaddr_un addr{};
+		addr.sun_family = AF_UNIX;
+
+		if (options_.socketPath.size() >= sizeof(addr.sun_path))
+			throw std::runtime_error("Socket path too long: " + options_.socketPath);
+
+		std::memcpy(addr.sun_path, options_.socketPath.c_str(), options_.socketPath.size() + 1);
+
+		listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (listenFd_ < 0)
+			throw std::runtime_error("Unable to create socket: " + options_.socketPath);
+
+		// A stale socket from a previous run would make bind fail
+		::unlink(options_.socketPath.c_str());
+
+		if (::bind(listenFd_, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0
+			|| ::chmod(options_.socketPath.c_str(), options_.socketMode) != 0
+			|| ::listen(listenFd_, SOMAXCONN) != 0)
+		{
+			::close(listenFd_);
+			listenFd_ = -1;
+			throw std::runtime_error("Unable to listen on socket: " + options_.socketPath);
+		}
+	}
+
+	void InferenceServer::serve_(int fd)
+	{
+		RequestHeader header;
+		std::string name;
+
+		while (readFully(fd, &header, sizeof(header)))
+		{
+			if (std::memcmp(header.magic, RequestMagic, sizeof(RequestMagic)) != 0 || header.nameBytes > MaxNameBytes)
+				return;
+
+			name.resize(header.nameBytes);
+			if (!readFully(fd, name.data(), name.size()))
+				return;
+
+			const auto it = models_.find(name);
+			if (it == models_.end())
+			{
+				// Without the model the sample size is unknown: the stream can't be resynchronized
+				respond(fd, UnknownModel, "Unknown model: " + name);
+				return;
+			}
+
+			auto &model = *it->second;
+			const auto op = static_cast<Op>(header.op);
+
+			if (op == Op::Info)
+			{
+				const uint32_t info[3] = {
+					static_cast<uint32_t>(model.sampleIn),
+					static_cast<uint32_t>(model.sampleOut),
+					static_cast<uint32_t>(model.maxRows)};
+				std::string payload;
+				append(payload, info, 3);
+
+				if (!respond(fd, Ok, payload))
+					return;
+				continue;
+			}
+
+			const std::size_t bytes = std::size_t(header.samples) * model.sampleIn * sizeof(Scalar);
+			if (bytes > MaxRequestBytes || op > Op::PredictTopK)
+			{
+				respond(fd, BadRequest, "Request too large or unknown op");
+				return;
+			}
+
+			Request_ request;
+			request.op = op;
+			request.samples = header.samples;
+			request.k = header.k;
+			request.x.resize(bytes / sizeof(Scalar));
+
+			if (!readFully(fd, request.x.data(), bytes))
+				return;
+
+			if (op == Op::PredictTopK && (request.k == 0 || request.k > model.sampleOut))
+			{
+				if (!respond(fd, BadRequest, "k must be between 1 and the output size"))
+					return;
+				continue;
+			}
+
+			if (request.samples == 0)
+			{
+				if (!respond(fd, Ok, ""))
+					return;
+				continue;
+			}
+
+			auto done = request.done.get_future();
+
+			if (!submit_(model, request))
+			{
+				respond(fd, ShuttingDown, "Server shutting down");
+				return;
+			}
+
+			done.wait();
+
+			if (!respond(fd, request.status, request.payload))
+				return;
+		}
+	}
+
+	bool InferenceServer::submit_(Model_ &model, Request_ &request)
+	{
+		{
+			std::lock_guard<std::mutex> lock(model.mutex);
+
+			// Workers exit once stopping with an empty queue: nothing may be queued after that
+			if (stopping_.load())
+				return false;
+
+			request.arrived = std::chrono::steady_clock::now();
+			model.queue.push_back(&request);
+			model.queuedSamples += request.samples;
+		}
+
+		model.ready.notify_all();
+		return true;
+	}
+
+	void InferenceServer::work_(Model_ &model)
+	{
+		std::vector<Request_ *> batch;
+
+		for (;;)
+		{
+			std::unique_lock<std::mutex> lock(model.mutex);
+
+			model.ready.wait(lock, [&] { return stopping_.load() || !model.queue.empty(); });
+
+			if (model.queue.empty())
+				return;
+
+			// Hold the batch open until it is full or its oldest request runs out of budget
+			const auto deadline = model.queue.front()->arrived + options_.maxDelay;
+			model.ready.wait_until(lock, deadline, [&]
+			{
+				return stopping_.load() || model.queue.empty() || model.queuedSamples >= model.maxRows;
+			});
+
+			// Another worker may have taken everything in the meantime
+			if (model.queue.empty())
+				continue;
+
+			batch.clear();
+			std::size_t rows = 0;
+
+			while (!model.queue.empty() && (batch.empty() || rows + model.queue.front()->samples <= model.maxRows))
+			{
+				auto *request = model.queue.front();
+				model.queue.pop_front();
+				model.queuedSamples -= request->samples;
+				rows += request->samples;
+				batch.push_back(request);
+			}
+
+			lock.unlock();
+
+			process_(model, batch, rows);
+		}
+	}
+
+	void InferenceServer::process_(Model_ &model, std::vector<Request_ *> &batch, std::size_t rows)
+	{
+		std::vector<Scalar> x;
+		std::vector<Scalar> output(rows * model.sampleOut);
+
+		try
+		{
+			const Scalar *input = batch.front()->x.data();
+
+			if (batch.size() > 1)
+			{
+				x.reserve(rows * model.sampleIn);
+				for (const auto *request : batch)
+					x.insert(x.end(), request->x.begin(), request->x.end());
+				input = x.data();
+			}
+
+			model.core->predictBatch(input, rows, output.data());
+		}
+		catch (const std::exception &ex)
+		{
+			for (auto *request : batch)
+			{
+				request->status = Failed;
+				request->payload = ex.what();
+				request->done.set_value();
+			}
+			return;
+		}
+
+		const Scalar *row = output.data();
+
+		for (auto *request : batch)
+		{
+			finish_(model, *request, row);
+			row += request->samples * model.sampleOut;
+			request->done.set_value();
+		}
+	}
+
+	void InferenceServer::finish_(Model_ &model, Request_ &request, const Scalar *output)
+	{
+		const auto n = request.samples;
+		auto &payload = request.payload;
+
+		if (request.op == Op::Predict)
+		{
+			append(payload, output, n * model.sampleOut);
+			return;
+		}
+
+		if (request.op == Op::PredictLabelInt)
+		{
+			std::vector<int32_t> labels(n);
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				const auto *r = output + i * model.sampleOut;
+				labels[i] = static_cast<int32_t>(std::max_element(r, r + model.sampleOut) - r);
+			}
+
+			append(payload, labels.data(), n);
+			return;
+		}
+
+		const auto k = request.k;
+		std::vector<int> ids(n * k, -1);
+		std::vector<Scalar> scores(n * k, 0.0f);
+
+		for (std::size_t i = 0; i < n; ++i)
+			Utility::topK(output + i * model.sampleOut, model.sampleOut, k, !model.probabilities, ids.data() + i * k, scores.data() + i * k);
+
+		append(payload, ids.data(), n * k);
+		append(payload, scores.data(), n * k);
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Core.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Local inference daemon: serves loaded models on a Unix domain socket and coalesces the samples
+	// of concurrent requests into micro-batches. A batch closes as soon as it fills the model's max
+	// batch size or its oldest request has waited maxDelay, so latency stays bounded at low load and
+	// throughput grows with it.
+	//
+	// Wire format, little-endian, one request at a time per connection:
+	//   request   "P2XQ", u32 op, u32 name bytes, u32 samples, u32 k, model name, samples * input floats
+	//   response  "P2XR", i32 status, u32 payload bytes, payload (an error message when status != 0)
+	// Payloads: Info       u32 sample input size, u32 sample output size, u32 max batch size
+	//           Predict    samples * output floats
+	//           Label      samples * i32
+	//           TopK       samples * k i32 ids, then samples * k float scores (id -1: padding)
+	class InferenceServer
+	{
+	public:
+		enum class Op : uint32_t
+		{
+			Info = 0,
+			Predict = 1,
+			PredictLabelInt = 2,
+			PredictTopK = 3
+		};
+
+		struct Options
+		{
+			std::string socketPath;
+			std::chrono::microseconds maxDelay{1000};
+			std::size_t workersPerModel = 1;
+			unsigned socketMode = 0660;
+		};
+
+		explicit InferenceServer(Options options);
+		~InferenceServer();
+
+		InferenceServer(const InferenceServer &) = delete;
+		InferenceServer &operator=(const InferenceServer &) = delete;
+
+		// {"socket": path, "max_delay_us": 1000, "workers": 1, "socket_mode": "0660",
+		//  "models": {"name": {"config": path, "weights": path} | {"bundle": path}}}
+		static std::unique_ptr<InferenceServer> fromConfig(const std::string &path);
+
+		void addModel(const std::string &name, std::unique_ptr<Core> core);
+		// Accepts connections until stop(), then drains the queued requests and returns
+		void run();
+		// Only sets a flag: safe from a signal handler
+		void stop();
+
+	private:
+		struct Request_
+		{
+			Op op = Op::Predict;
+			std::size_t samples = 0;
+			std::size_t k = 0;
+			std::vector<Scalar> x;
+			std::chrono::steady_clock::time_point arrived;
+			int32_t status = 0;
+			std::string payload;
+			std::promise<void> done;
+		};
+
+		struct Model_
+		{
+			std::unique_ptr<Core> core;
+			std::size_t sampleIn = 0;
+			std::size_t sampleOut = 0;
+			std::size_t maxRows = 1;
+			bool probabilities = false;
+
+			std::mutex mutex;
+			std::condition_variable ready;
+			std::deque<Request_ *> queue;
+			std::size_t queuedSamples = 0;
+			std::vector<std::thread> workers;
+		};
+
+		Options options_;
+		std::unordered_map<std::string, std::unique_ptr<Model_>> models_;
+		std::atomic<bool> stopping_{false};
+		int listenFd_ = -1;
+
+		std::mutex connectionsMutex_;
+		std::condition_variable connectionsDone_;
+		std::vector<int> connections_;
+
+		void listen_();
+		void serve_(int fd);
+		bool submit_(Model_ &model, Request_ &request);
+		void work_(Model_ &model);
+		void process_(Model_ &model, std::vector<Request_ *> &batch, std::size_t rows);
+		void finish_(Model_ &model, Request_ &request, const Scalar *output);
+	};
+}
@@ -0,0 +1,217 @@
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "json_loader.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	namespace
+	{
+		// DOM builder that diverts tensor data arrays into a TensorDataMap
+		class TensorDataSax final : public nlohmann::json_sax<json>
+		{
+		public:
+			TensorDataSax(json &root, TensorDataMap &tensorData)
+				: root_(root), tensorData_(tensorData)
+			{
+			}
+
+			bool null() override
+			{
+				return value_(nullptr);
+			}
+
+			bool boolean(bool value) override
+			{
+				return value_(value);
+			}
+
+			bool number_integer(number_integer_t value) override
+			{
+				return capture_ != nullptr ? push_(static_cast<Scalar>(value)) : value_(value);
+			}
+
+			bool number_unsigned(number_unsigned_t value) override
+			{
+				return capture_ != nullptr ? push_(static_cast<Scalar>(value)) : value_(value);
+			}
+
+			bool number_float(number_float_t value, const string_t &) override
+			{
+				return capture_ != nullptr ? push_(static_cast<Scalar>(value)) : value_(value);
+			}
+
+			bool string(string_t &value) override
+			{
+				return value_(std::move(value));
+			}
+
+			bool binary(binary_t &value) override
+			{
+				return value_(json::binary(std::move(value)));
+			}
+
+			bool start_object(std::size_t) override
+			{
+				return open_(json::object());
+			}
+
+			bool key(string_t &value) override
+			{
+				key_ = std::move(value);
+				return true;
+			}
+
+			bool end_object() override
+			{
+				stack_.pop_back();
+				names_.pop_back();
+				return true;
+			}
+
+			bool start_array(std::size_t) override
+			{
+				if (capture_ != nullptr)
+				{
+					// Nested data arrays are flattened in row-major order
+					++captureDepth_;
+					return true;
+				}
+
+				if (isTensorData_())
+				{
+					auto &data = tensorData_[names_.back()];
+					data.clear();
+
+					// Keys are usually sorted, so "data" comes before "shape": reserve only if known
+					const auto &entry = *stack_.back();
+					const auto shape = entry.find("shape");
+					if (shape != entry.end() && shape->is_array())
+					{
+						std::size_t size = 1;
+						for (const auto &dim : *shape)
+							size *= dim.is_number_unsigned() ? dim.get<std::size_t>() : 0;
+						data.reserve(size);
+					}
+
+					capture_ = &data;
+					captureDepth_ = 1;
+					return true;
+				}
+
+				return open_(json::array());
+			}
+
+			bool end_array() override
+			{
+				if (capture_ != nullptr)
+				{
+					if (--captureDepth_ == 0)
+						capture_ = nullptr;
+					return true;
+				}
+
+				stack_.pop_back();
+				names_.pop_back();
+				return true;
+			}
+
+			bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex) override
+			{
+				throw std::runtime_error(std::string("Invalid JSON: ") + ex.what());
+			}
+
+		private:
+			json &root_;
+			TensorDataMap &tensorData_;
+			std::vector<json *> stack_;
+			std::vector<std::string> names_;
+			std::string key_;
+			std::vector<Scalar> *capture_ = nullptr;
+			int captureDepth_ = 0;
+
+			bool push_(Scalar value)
+			{
+				capture_->push_back(value);
+				return true;
+			}
+
+			json *insert_(json &&value)
+			{
+				if (stack_.empty())
+				{
+					root_ = std::move(value);
+					return &root_;
+				}
+
+				auto &parent = *stack_.back();
+
+				if (parent.is_array())
+				{
+					parent.push_back(std::move(value));
+					return &parent.back();
+				}
+
+				auto &slot = parent[key_];
+				slot = std::move(value);
+				return &slot;
+			}
+
+			bool value_(json &&value)
+			{
+				if (capture_ != nullptr)
+					throw std::runtime_error("Invalid JSON: tensor data must contain only numbers");
+
+				insert_(std::move(value));
+				return true;
+			}
+
+			bool open_(json &&container)
+			{
+				if (capture_ != nullptr)
+					throw std::runtime_error("Invalid JSON: tensor data must contain only numbers");
+
+				std::string name;
+				if (!stack_.empty())
+					name = stack_.back()->is_array() ? std::to_string(stack_.back()->size()) : key_;
+
+				stack_.push_back(insert_(std::move(container)));
+				names_.push_back(std::move(name));
+				return true;
+			}
+
+			// "data" member of an entry directly inside a "tensors" array or object
+			bool isTensorData_() const
+			{
+				return key_ == "data"
+					&& stack_.size() >= 2
+					&& stack_.back()->is_object()
+					&& names_[names_.size() - 2] == "tensors";
+			}
+		};
+	}
+
+	JsonLoader::Document JsonLoader::load(const std::string &path)
+	{
+		std::ifstream file(path, std::ios::binary);
+
+		if (!file.is_open())
+			throw std::runtime_error("Unable to open graph file: " + path);
+
+		Document document;
+		TensorDataSax sax(document.doc, document.tensorData);
+		json::sax_parse(file, &sax);
+		return document;
+	}
+
+	JsonLoader::Document JsonLoader::parse(const std::string &text)
+	{
+		Document document;
+		TensorDataSax sax(document.doc, document.tensorData);
+		json::sax_parse(text, &sax);
+		return document;
+	}
+}
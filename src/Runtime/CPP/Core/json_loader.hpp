@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../ThirdParty/nlohmann/json.hpp"
+#include "../types.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	using nlohmann::json;
+
+	// Numeric "data" arrays of tensor entries, keyed by the entry's position in its "tensors"
+	// container: the array index for graph definitions, the object key (tensor id) for weights.
+	using TensorDataMap = std::unordered_map<std::string, std::vector<Scalar>>;
+
+	// Streaming JSON loader built on the nlohmann SAX interface. Everything is kept as a DOM
+	// except "tensors[*].data", which is parsed straight into float vectors that are later
+	// moved into Tensor::data: no json node is ever created for a tensor element.
+	class JsonLoader
+	{
+	public:
+		struct Document
+		{
+			json doc;
+			TensorDataMap tensorData;
+		};
+
+		static Document load(const std::string &path);
+		static Document parse(const std::string &text);
+	};
+}
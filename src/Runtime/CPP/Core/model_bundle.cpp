@@ -0,0 +1,447 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "model_bundle.hpp"
+#include "runtime.hpp"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	#error "Model bundles are stored little-endian: big-endian hosts are not supported"
+#endif
+
+namespace PHP2xAI::Runtime::CPP
+{
+	namespace
+	{
+		constexpr char Magic[4] = {'P', '2', 'X', 'B'};
+		constexpr uint32_t Version = 1;
+		constexpr std::size_t MaxRank = 8;
+		constexpr std::size_t MaxInputs = 4;
+		constexpr std::size_t MaxAxes = 8;
+		constexpr std::size_t Alignment = 64;
+
+		// Header flags; a bundle with neither batch flag falls back to the input rank
+		constexpr uint32_t FlagBatched = 1;
+		constexpr uint32_t FlagUnbatched = 2;
+
+		struct BundleHeader
+		{
+			char magic[4];
+			uint32_t version;
+			uint32_t tensorCount;
+			uint32_t opCount;
+			uint32_t trainableCount;
+			int32_t lossId;
+			int32_t outputId;
+			int32_t maxBatchSize;
+			int32_t maxSequenceLength;
+			uint32_t flags;
+			uint64_t tensorTable;
+			uint64_t opTable;
+			uint64_t trainableTable;
+			uint64_t strings;
+			uint64_t stringsBytes;
+		};
+
+		struct TensorRecord
+		{
+			int32_t id;
+			uint32_t kindOffset;
+			uint32_t kindLength;
+			uint32_t nameOffset;
+			uint32_t nameLength;
+			uint32_t rank;
+			int32_t shape[MaxRank];
+			uint64_t dataOffset;
+			uint64_t dataCount;
+		};
+
+		struct OpRecord
+		{
+			int32_t id;
+			uint32_t opOffset;
+			uint32_t opLength;
+			uint32_t kernelOffset;
+			uint32_t kernelLength;
+			int32_t output;
+			uint32_t inputCount;
+			uint32_t axesCount;
+			int32_t inputs[MaxInputs];
+			int32_t axes[MaxAxes];
+		};
+
+		static_assert(sizeof(BundleHeader) == 80, "unexpected bundle header size");
+		static_assert(sizeof(TensorRecord) == 72, "unexpected bundle tensor record size");
+		static_assert(sizeof(OpRecord) == 80, "unexpected bundle op record size");
+
+		std::size_t alignUp(std::size_t value)
+		{
+			return (value + Alignment - 1) / Alignment * Alignment;
+		}
+
+		// Element count of a shape, false on a negative extent or overflow
+		bool shapeCount(const int32_t *shape, uint32_t rank, uint64_t &count)
+		{
+			count = 1;
+
+			for (uint32_t a = 0; a < rank; ++a)
+			{
+				if (shape[a] < 0)
+					return false;
+
+				const auto dim = static_cast<uint64_t>(shape[a]);
+				if (dim != 0 && count > UINT64_MAX / dim)
+					return false;
+
+				count *= dim;
+			}
+
+			return true;
+		}
+
+		// Inputs read by GraphRuntime::forwardOp/backwardOp for each op
+		uint32_t opArity(std::string_view op)
+		{
+			if (op == "matmul" || op == "add" || op == "CE" || op == "softmax_ce_logits" || op == "softmax_ce_logits_label_int")
+				return 2;
+			return 1;
+		}
+
+		struct StringPool
+		{
+			std::string bytes;
+
+			std::pair<uint32_t, uint32_t> add(const std::string &s)
+			{
+				const auto offset = static_cast<uint32_t>(bytes.size());
+				bytes += s;
+				return {offset, static_cast<uint32_t>(s.size())};
+			}
+		};
+	}
+
+	ModelBundle::ModelBundle(const std::string &path)
+		: path_(path)
+	{
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Unable to open model bundle: " + path);
+
+		struct stat st{};
+		if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(BundleHeader))
+		{
+			::close(fd);
+			throw std::runtime_error("Invalid model bundle: " + path);
+		}
+
+		mappedBytes_ = static_cast<std::size_t>(st.st_size);
+		// Copy-on-write: pages stay shared with the page cache, and with every other process
+		// mapping this file, until a param viewing them is written
+		mapped_ = ::mmap(nullptr, mappedBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (mapped_ == MAP_FAILED)
+		{
+			mapped_ = nullptr;
+			throw std::runtime_error("Unable to mmap model bundle: " + path);
+		}
+
+		const auto *base = static_cast<const unsigned char *>(mapped_);
+		BundleHeader header;
+		std::memcpy(&header, base, sizeof(header));
+
+		if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version)
+			fail_("Invalid model bundle: ");
+
+		const auto inBounds = [this](uint64_t offset, uint64_t bytes)
+		{
+			return offset <= mappedBytes_ && bytes <= mappedBytes_ - offset;
+		};
+
+		if (!inBounds(header.tensorTable, uint64_t{header.tensorCount} * sizeof(TensorRecord))
+			|| !inBounds(header.opTable, uint64_t{header.opCount} * sizeof(OpRecord))
+			|| !inBounds(header.trainableTable, uint64_t{header.trainableCount} * sizeof(int32_t))
+			|| !inBounds(header.strings, header.stringsBytes))
+			fail_("Truncated model bundle: ");
+
+		const auto *strings = reinterpret_cast<const char *>(base + header.strings);
+		const auto text = [&](uint32_t offset, uint32_t length)
+		{
+			if (uint64_t{offset} + length > header.stringsBytes)
+				fail_("Invalid string in model bundle: ");
+			return std::string_view(strings + offset, length);
+		};
+
+		// Fixup: records stay in the mapping, only offsets are resolved into views and pointers
+		tensors_.reserve(header.tensorCount);
+		for (uint32_t i = 0; i < header.tensorCount; ++i)
+		{
+			TensorRecord r;
+			std::memcpy(&r, base + header.tensorTable + i * sizeof(TensorRecord), sizeof(r));
+
+			// Data is optional (zero initialized) but, when present, holds exactly the shape's elements
+			uint64_t elements = 0;
+			if (r.rank > MaxRank || r.id < 0 || static_cast<uint32_t>(r.id) >= header.tensorCount
+				|| !shapeCount(r.shape, r.rank, elements)
+				|| (r.dataCount != 0 && r.dataCount != elements)
+				|| (r.dataCount != 0 && r.dataOffset % Alignment != 0)
+				|| r.dataCount > mappedBytes_ / sizeof(Scalar)
+				|| !inBounds(r.dataOffset, r.dataCount * sizeof(Scalar)))
+				fail_("Invalid tensor record in model bundle: ");
+
+			TensorInfo info;
+			info.id = r.id;
+			info.kind = text(r.kindOffset, r.kindLength);
+			info.name = text(r.nameOffset, r.nameLength);
+			info.shape.assign(r.shape, r.shape + r.rank);
+			info.count = static_cast<std::size_t>(r.dataCount);
+			info.data = r.dataCount > 0 ? reinterpret_cast<const Scalar *>(base + r.dataOffset) : nullptr;
+			tensors_.push_back(std::move(info));
+		}
+
+		ops_.reserve(header.opCount);
+		for (uint32_t i = 0; i < header.opCount; ++i)
+		{
+			OpRecord r;
+			std::memcpy(&r, base + header.opTable + i * sizeof(OpRecord), sizeof(r));
+
+			const auto tensorId = [&header](int32_t id)
+			{
+				return id >= 0 && static_cast<uint32_t>(id) < header.tensorCount;
+			};
+
+			if (r.inputCount > MaxInputs || r.axesCount > MaxAxes || !tensorId(r.output))
+				fail_("Invalid op record in model bundle: ");
+
+			for (uint32_t k = 0; k < r.inputCount; ++k)
+			{
+				if (!tensorId(r.inputs[k]))
+					fail_("Invalid op record in model bundle: ");
+			}
+
+			OpInfo info;
+			info.id = r.id;
+			info.op = text(r.opOffset, r.opLength);
+			if (r.inputCount < opArity(info.op))
+				fail_("Invalid op record in model bundle: ");
+			info.kernel = text(r.kernelOffset, r.kernelLength);
+			info.inputs.assign(r.inputs, r.inputs + r.inputCount);
+			info.output = r.output;
+			info.axes.assign(r.axes, r.axes + r.axesCount);
+			ops_.push_back(std::move(info));
+		}
+
+		trainable_.resize(header.trainableCount);
+		for (uint32_t i = 0; i < header.trainableCount; ++i)
+		{
+			int32_t id;
+			std::memcpy(&id, base + header.trainableTable + i * sizeof(int32_t), sizeof(id));
+			if (id < 0 || static_cast<uint32_t>(id) >= header.tensorCount)
+				fail_("Invalid trainable id in model bundle: ");
+			trainable_[i] = id;
+		}
+
+		const auto outOfRange = [&header](int32_t id)
+		{
+			return id < 0 || static_cast<uint32_t>(id) >= header.tensorCount;
+		};
+
+		if (outOfRange(header.lossId) || outOfRange(header.outputId))
+			fail_("Invalid loss or output id in model bundle: ");
+
+		lossId_ = header.lossId;
+		outputId_ = header.outputId;
+		maxBatchSize_ = header.maxBatchSize;
+		maxSequenceLength_ = header.maxSequenceLength;
+
+		if (header.flags & FlagBatched)
+			batched_ = true;
+		else if (header.flags & FlagUnbatched)
+			batched_ = false;
+	}
+
+	ModelBundle::~ModelBundle()
+	{
+		if (mapped_ != nullptr)
+			::munmap(mapped_, mappedBytes_);
+	}
+
+	const std::vector<ModelBundle::TensorInfo> &ModelBundle::tensors() const { return tensors_; }
+
+	const std::vector<ModelBundle::OpInfo> &ModelBundle::ops() const { return ops_; }
+
+	const std::vector<int> &ModelBundle::trainable() const { return trainable_; }
+
+	int ModelBundle::lossId() const { return lossId_; }
+
+	int ModelBundle::outputId() const { return outputId_; }
+
+	int ModelBundle::maxBatchSize() const { return maxBatchSize_; }
+
+	int ModelBundle::maxSequenceLength() const { return maxSequenceLength_; }
+
+	std::optional<bool> ModelBundle::batched() const { return batched_; }
+
+	bool ModelBundle::isBundle(const std::string &path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		char magic[4] = {};
+
+		return file.read(magic, sizeof(magic)) && std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+	}
+
+	void ModelBundle::write(const std::string &path, const GraphRuntime &graph)
+	{
+		StringPool pool;
+		std::vector<TensorRecord> tensorTable(graph.tensors.size());
+		std::vector<OpRecord> opTable(graph.ops.size());
+		std::vector<int32_t> trainableTable(graph.trainable.begin(), graph.trainable.end());
+
+		for (std::size_t i = 0; i < graph.tensors.size(); ++i)
+		{
+			const auto &t = graph.tensors[i];
+
+			if (t.shape.size() > MaxRank)
+				throw std::runtime_error("Tensor rank too high for a model bundle: " + t.name);
+
+			auto &r = tensorTable[i];
+			r = TensorRecord{};
+			r.id = t.id;
+			std::tie(r.kindOffset, r.kindLength) = pool.add(t.kind);
+			std::tie(r.nameOffset, r.nameLength) = pool.add(t.name);
+			r.rank = static_cast<uint32_t>(t.shape.size());
+			for (std::size_t a = 0; a < t.shape.size(); ++a)
+				r.shape[a] = t.shape[a];
+		}
+
+		for (std::size_t i = 0; i < graph.ops.size(); ++i)
+		{
+			const auto &o = graph.ops[i];
+
+			if (o.inputs.size() > MaxInputs || o.axes.size() > MaxAxes)
+				throw std::runtime_error("Op does not fit in a model bundle: " + o.op);
+
+			auto &r = opTable[i];
+			r = OpRecord{};
+			r.id = o.id;
+			std::tie(r.opOffset, r.opLength) = pool.add(o.op);
+			std::tie(r.kernelOffset, r.kernelLength) = pool.add(o.kernel);
+			r.output = o.output;
+			r.inputCount = static_cast<uint32_t>(o.inputs.size());
+			r.axesCount = static_cast<uint32_t>(o.axes.size());
+			for (std::size_t k = 0; k < o.inputs.size(); ++k)
+				r.inputs[k] = o.inputs[k];
+			for (std::size_t k = 0; k < o.axes.size(); ++k)
+				r.axes[k] = o.axes[k];
+		}
+
+		BundleHeader header{};
+		std::memcpy(header.magic, Magic, sizeof(Magic));
+		header.version = Version;
+		header.tensorCount = static_cast<uint32_t>(tensorTable.size());
+		header.opCount = static_cast<uint32_t>(opTable.size());
+		header.trainableCount = static_cast<uint32_t>(trainableTable.size());
+		header.lossId = graph.lossId;
+		header.outputId = graph.outputId;
+		header.maxBatchSize = graph.getMaxBatchSize();
+		header.maxSequenceLength = graph.getMaxSequenceLength();
+		const bool batched = static_cast<std::size_t>(graph.inputId) < graph.tensors.size()
+			&& graph.tensors[static_cast<std::size_t>(graph.inputId)].batched;
+		header.flags = batched ? FlagBatched : FlagUnbatched;
+
+		header.tensorTable = alignUp(sizeof(BundleHeader));
+		header.opTable = alignUp(header.tensorTable + tensorTable.size() * sizeof(TensorRecord));
+		header.trainableTable = alignUp(header.opTable + opTable.size() * sizeof(OpRecord));
+		header.strings = alignUp(header.trainableTable + trainableTable.size() * sizeof(int32_t));
+		header.stringsBytes = pool.bytes.size();
+
+		// Params and constants (tensors no op writes, e.g. registered through GraphContext::registerTensor)
+		// keep their data. Op outputs are recomputed and inputs/targets are fed, so both start from zero
+		std::vector<bool> computed(graph.tensors.size(), false);
+		for (const auto &o : graph.ops)
+		{
+			if (o.output >= 0 && static_cast<std::size_t>(o.output) < computed.size())
+				computed[static_cast<std::size_t>(o.output)] = true;
+		}
+
+		std::size_t offset = alignUp(header.strings + header.stringsBytes);
+		for (std::size_t i = 0; i < graph.tensors.size(); ++i)
+		{
+			const auto &t = graph.tensors[i];
+			if (computed[i] || t.kind == "input" || t.kind == "target" || t.data.empty())
+				continue;
+
+			std::size_t elements = 1;
+			for (int dim : t.shape)
+				elements *= static_cast<std::size_t>(dim);
+
+			if (t.data.size() != elements)
+				throw std::runtime_error("Tensor data does not match its shape: " + t.name);
+
+			tensorTable[i].dataOffset = offset;
+			tensorTable[i].dataCount = t.data.size();
+			offset = alignUp(offset + t.data.size() * sizeof(Scalar));
+		}
+
+		// Written aside and renamed over path: processes mapping the old file keep their pages
+		const auto tmpPath = path + ".tmp";
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			throw std::runtime_error("Unable to open file for writing: " + tmpPath);
+
+		std::size_t written = 0;
+		const auto put = [&](uint64_t at, const void *bytes, std::size_t size)
+		{
+			static const char zeros[Alignment] = {};
+			file.write(zeros, static_cast<std::streamsize>(at - written));
+			file.write(static_cast<const char *>(bytes), static_cast<std::streamsize>(size));
+			written = at + size;
+		};
+
+		put(0, &header, sizeof(header));
+		put(header.tensorTable, tensorTable.data(), tensorTable.size() * sizeof(TensorRecord));
+		put(header.opTable, opTable.data(), opTable.size() * sizeof(OpRecord));
+		put(header.trainableTable, trainableTable.data(), trainableTable.size() * sizeof(int32_t));
+		put(header.strings, pool.bytes.data(), pool.bytes.size());
+
+		for (std::size_t i = 0; i < graph.tensors.size(); ++i)
+		{
+			if (tensorTable[i].dataCount == 0)
+				continue;
+
+			const auto &data = graph.tensors[i].data;
+			put(tensorTable[i].dataOffset, data.data(), data.size() * sizeof(Scalar));
+		}
+
+		file.close();
+
+		if (!file)
+		{
+			std::remove(tmpPath.c_str());
+			throw std::runtime_error("Unable to write model bundle: " + path);
+		}
+
+		if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+		{
+			std::remove(tmpPath.c_str());
+			throw std::runtime_error("Unable to rename model bundle: " + tmpPath);
+		}
+	}
+
+	void ModelBundle::fail_(const std::string &message)
+	{
+		::munmap(mapped_, mappedBytes_);
+		mapped_ = nullptr;
+		throw std::runtime_error(message + path_);
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../types.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	class GraphRuntime;
+
+	// Single-file model: header, tensor table, op plan, trainable ids, string pool and the
+	// float32 data of every param and constant aligned to 64 bytes. Opened through a private mmap; the
+	// runtime is rebuilt from the tables without any JSON parsing.
+	class ModelBundle
+	{
+	public:
+		struct TensorInfo
+		{
+			int id{};
+			std::string_view kind;
+			std::string_view name;
+			std::vector<int> shape;
+			const Scalar *data = nullptr;          // nullptr: zero initialized
+			std::size_t count = 0;
+		};
+
+		struct OpInfo
+		{
+			int id{};
+			std::string_view op;
+			std::string_view kernel;
+			std::vector<int> inputs;
+			int output{};
+			std::vector<int> axes;
+		};
+
+		explicit ModelBundle(const std::string &path);
+		~ModelBundle();
+
+		ModelBundle(const ModelBundle &) = delete;
+		ModelBundle &operator=(const ModelBundle &) = delete;
+
+		const std::vector<TensorInfo> &tensors() const;
+		const std::vector<OpInfo> &ops() const;
+		const std::vector<int> &trainable() const;
+		int lossId() const;
+		int outputId() const;
+		int maxBatchSize() const;
+		int maxSequenceLength() const;
+		// Whether axis 0 of the input is the batch, unset for bundles written before the flag existed
+		std::optional<bool> batched() const;
+
+		static bool isBundle(const std::string &path);
+		static void write(const std::string &path, const GraphRuntime &graph);
+
+	private:
+		std::string path_;
+		void *mapped_ = nullptr;
+		std::size_t mappedBytes_ = 0;
+
+		std::vector<TensorInfo> tensors_;
+		std::vector<OpInfo> ops_;
+		std::vector<int> trainable_;
+		int lossId_{};
+		int outputId_{};
+		int maxBatchSize_{};
+		int maxSequenceLength_{};
+		std::optional<bool> batched_;
+
+		void fail_(const std::string &message);
+	};
+}
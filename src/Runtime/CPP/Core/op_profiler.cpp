@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <utility>
+#include "op_profiler.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	namespace
+	{
+		json countersJson(const OpProfiler::Counters &counters)
+		{
+			const auto seconds = counters.seconds;
+
+			return {
+				{"calls", counters.calls},
+				{"seconds", seconds},
+				{"flops", counters.flops},
+				{"bytes", counters.bytes},
+				{"gflops", seconds > 0.0 ? counters.flops / seconds * 1e-9 : 0.0},
+				{"gbps", seconds > 0.0 ? counters.bytes / seconds * 1e-9 : 0.0}
+			};
+		}
+	}
+
+	void OpProfiler::Counters::add(const Counters &other)
+	{
+		calls += other.calls;
+		seconds += other.seconds;
+		flops += other.flops;
+		bytes += other.bytes;
+	}
+
+	void OpProfiler::addOp(int id, const std::string &op, const std::string &kernel)
+	{
+		Entry entry;
+		entry.id = id;
+		entry.op = op;
+		entry.kernel = kernel.empty() ? op : kernel;
+		entries_.push_back(std::move(entry));
+	}
+
+	void OpProfiler::record(std::size_t index, bool backward, double seconds, double flops, double bytes)
+	{
+		auto &counters = backward ? entries_[index].backward : entries_[index].forward;
+
+		++counters.calls;
+		counters.seconds += seconds;
+		counters.flops += flops;
+		counters.bytes += bytes;
+	}
+
+	void OpProfiler::reset()
+	{
+		for (auto &entry : entries_)
+		{
+			entry.forward = Counters{};
+			entry.backward = Counters{};
+		}
+	}
+
+	const std::vector<OpProfiler::Entry> &OpProfiler::entries() const
+	{
+		return entries_;
+	}
+
+	json OpProfiler::toJson() const
+	{
+		json ops = json::array();
+		std::map<std::string, std::pair<Counters, Counters>> kernels;
+		Counters forward;
+		Counters backward;
+
+		for (const auto &entry : entries_)
+		{
+			ops.push_back({
+				{"id", entry.id},
+				{"op", entry.op},
+				{"kernel", entry.kernel},
+				{"forward", countersJson(entry.forward)},
+				{"backward", countersJson(entry.backward)}
+			});
+
+			auto &kernel = kernels[entry.kernel];
+			kernel.first.add(entry.forward);
+			kernel.second.add(entry.backward);
+			forward.add(entry.forward);
+			backward.add(entry.backward);
+		}
+
+		json byKernel = json::object();
+		for (const auto &[name, counters] : kernels)
+			byKernel[name] = {{"forward", countersJson(counters.first)}, {"backward", countersJson(counters.second)}};
+
+		return {
+			{"ops", std::move(ops)},
+			{"kernels", std::move(byKernel)},
+			{"forward_seconds", forward.seconds},
+			{"backward_seconds", backward.seconds}
+		};
+	}
+
+	std::string OpProfiler::report() const
+	{
+		struct Row
+		{
+			std::string name;
+			Counters counters;
+		};
+
+		std::map<std::string, Counters> merged;
+		double total = 0.0;
+
+		for (const auto &entry : entries_)
+		{
+			merged[entry.kernel].add(entry.forward);
+			merged["BACKWARD " + entry.kernel].add(entry.backward);
+			total += entry.forward.seconds + entry.backward.seconds;
+		}
+
+		std::vector<Row> rows;
+		for (const auto &[name, counters] : merged)
+		{
+			if (counters.calls > 0)
+				rows.push_back({name, counters});
+		}
+
+		std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b)
+		{
+			return a.counters.seconds > b.counters.seconds;
+		});
+
+		std::ostringstream out;
+		char line[256];
+
+		std::snprintf(line, sizeof(line), "%-48s %10s %10s %6s %9s %9s\n", "kernel", "calls", "ms", "%", "GFLOP/s", "GB/s");
+		out << line;
+
+		for (const auto &row : rows)
+		{
+			const auto &c = row.counters;
+			std::snprintf(line, sizeof(line), "%-48s %10llu %10.2f %6.1f %9.2f %9.2f\n",
+				row.name.c_str(),
+				static_cast<unsigned long long>(c.calls),
+				c.seconds * 1e3,
+				total > 0.0 ? c.seconds / total * 100.0 : 0.0,
+				c.seconds > 0.0 ? c.flops / c.seconds * 1e-9 : 0.0,
+				c.seconds > 0.0 ? c.bytes / c.seconds * 1e-9 : 0.0);
+			out << line;
+		}
+
+		return out.str();
+	}
+}
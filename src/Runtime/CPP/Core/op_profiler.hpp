@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../ThirdParty/nlohmann/json.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	using nlohmann::json;
+
+	// Accumulates wall time, calls and estimated FLOPs / bytes moved of each graph op, forward and
+	// backward apart. Filled by GraphRuntime while profiling is on; FLOPs and bytes are computed
+	// from the shapes of each call, so they follow batch size and sequence length changes.
+	class OpProfiler
+	{
+	public:
+		struct Counters
+		{
+			uint64_t calls = 0;
+			double seconds = 0.0;
+			double flops = 0.0;
+			double bytes = 0.0;
+
+			void add(const Counters &other);
+		};
+
+		struct Entry
+		{
+			int id = 0;
+			std::string op;
+			std::string kernel;
+			Counters forward;
+			Counters backward;
+		};
+
+		void addOp(int id, const std::string &op, const std::string &kernel);
+		void record(std::size_t index, bool backward, double seconds, double flops, double bytes);
+		void reset();
+		const std::vector<Entry> &entries() const;
+
+		// {"ops": [{id, op, kernel, forward, backward}], "kernels": {name: {forward, backward}},
+		//  "forward_seconds", "backward_seconds"}; counters carry calls, seconds, flops, bytes,
+		//  gflops and gbps
+		json toJson() const;
+		// Per-kernel table, slowest first, for the training log
+		std::string report() const;
+
+	private:
+		std::vector<Entry> entries_;
+	};
+}
@@ -1,9 +1,14 @@
 #include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <fstream>
+#include <memory>
 #include <utility>
 #include "runtime.hpp"
+#include "model_bundle.hpp"
+#include "weights_file.hpp"
 
 namespace PHP2xAI::Runtime::CPP
 {
@@ -42,13 +47,13 @@ namespace PHP2xAI::Runtime::CPP
 		}
 
 		static void bmmGenericBroadcast(
-			const std::vector<Scalar> &aData,
+			const TensorStorage &aData,
 			const std::vector<int> &aShape,
 			const std::vector<int> &aStrides,
-			const std::vector<Scalar> &bData,
+			const TensorStorage &bData,
 			const std::vector<int> &bShape,
 			const std::vector<int> &bStrides,
-			std::vector<Scalar> &cData,
+			TensorStorage &cData,
 			const std::vector<int> &cShape,
 			const std::vector<int> &cStrides)
 		{
@@ -159,11 +164,11 @@ namespace PHP2xAI::Runtime::CPP
 		}
 
 		static void bmmGenericBroadcastBackward(
-			const std::vector<Scalar> &aData,
+			const TensorStorage &aData,
 			const std::vector<int> &aShape,
 			const std::vector<int> &aStrides,
 			std::vector<Scalar> &aGrad,
-			const std::vector<Scalar> &bData,
+			const TensorStorage &bData,
 			const std::vector<int> &bShape,
 			const std::vector<int> &bStrides,
 			std::vector<Scalar> &bGrad,
@@ -276,21 +281,32 @@ namespace PHP2xAI::Runtime::CPP
 		}
 	}
 
-	GraphRuntime::GraphRuntime(const json &graphDef, const std::string &weightsPath)
+	GraphRuntime::GraphRuntime(const json &graphDef, const std::string &weightsPath, TensorDataMap graphData, bool shareWeights)
 		: graphDef_(graphDef)
 	{
-		json weightsDef;
-		const json *weightsPtr = nullptr;
+		JsonLoader::Document weightsDef;
+		JsonLoader::Document *weightsPtr = nullptr;
+		std::shared_ptr<const WeightsFile> weightsBin;
 
-		if (!weightsPath.empty())
+		if (!weightsPath.empty() && WeightsFile::isBinary(weightsPath))
 		{
-			weightsDef = loadJson(weightsPath);
+			weightsBin = std::make_shared<const WeightsFile>(weightsPath);
+		}
+		else if (!weightsPath.empty())
+		{
+			weightsDef = JsonLoader::load(weightsPath);
 			weightsPtr = &weightsDef;
 		}
 
-		loadTensors(graphDef_, weightsPtr);
+		loadTensors(graphDef_, graphData, weightsPtr, weightsBin.get(), shareWeights);
 		loadOps(graphDef_);
 
+		if (shareWeights && weightsBin)
+			weightsMapping_ = weightsBin;
+		markBatchedTensors();
+		markTimedTensors();
+		reserveCapacity();
+
 		if (graphDef_.contains("loss"))
 			lossId = graphDef_.at("loss").get<int>();
 
@@ -301,99 +317,266 @@ namespace PHP2xAI::Runtime::CPP
 			trainable = graphDef_.at("trainable").get<std::vector<int>>();
 	}
 
-	void GraphRuntime::forward()
+	GraphRuntime::GraphRuntime(std::shared_ptr<const ModelBundle> bundlePtr, bool shareWeights)
 	{
-		for (const auto &op : ops)
+		const auto &bundle = *bundlePtr;
+
+		// Limits read by markBatchedTensors/markTimedTensors when the graph comes from JSON
+		graphDef_ = json::object();
+		if (bundle.maxBatchSize() > 0)
+			graphDef_["max_batch_size"] = bundle.maxBatchSize();
+		if (bundle.maxSequenceLength() > 0)
+			graphDef_["max_sequence_length"] = bundle.maxSequenceLength();
+		if (bundle.batched())
+			graphDef_["batched"] = *bundle.batched();
+
+		tensors.reserve(bundle.tensors().size());
+
+		for (const auto &info : bundle.tensors())
 		{
-			const auto &name = op.op;
-			const auto &inputs = op.inputs;
-			const auto outId = op.output;
-
-			if (name == "matmul")
-				opMatmul(inputs[0], inputs[1], outId, op.kernel);
-			else if (name == "add")
-				opAdd(inputs[0], inputs[1], outId, op.kernel);
-			// else if (name == "sub")
-			// 	opSub(inputs[0], inputs[1], outId);
-			// else if (name == "dot")
-			// 	opDot(inputs[0], inputs[1], outId);
-			else if (name == "dropout")
-				opDropout(inputs[0], outId);
-			else if (name == "sig")
-				opSig(inputs[0], outId);
-			else if (name == "ReLU" || name == "relu")
-				opRelu(inputs[0], outId);
-			// else if (name == "LReLU")
-			// 	opLRelu(inputs[0], outId);
-			// else if (name == "MSE")
-			// 	opMse(inputs[0], outId);
-			// else if (name == "MAE")
-			// 	opMae(inputs[0], outId);
-			else if (name == "mean")
-				opMean(inputs[0], outId, op.kernel, op.axes);
-			else if (name == "softmax")
-				opSoftmax(inputs[0], outId, op.kernel, op.axes);
-			else if (name == "CE")
-				opCe(inputs[0], inputs[1], outId);
-			else if (name == "softmax_ce_logits")
-				opCeLogits(inputs[0], inputs[1], outId);
-			else if (name == "softmax_ce_logits_label_int")
-				opCeLogitsLabelInt(inputs[0], inputs[1], outId, op.kernel, op.axes);
+			Tensor tensor;
+			tensor.id = info.id;
+			tensor.kind = std::string(info.kind);
+			tensor.name = std::string(info.name);
+			tensor.shape = info.shape;
+			tensor.baseOffset = 0;
+			tensor.strides = Tensor::computeStrides(tensor.shape);
+
+			if (info.data != nullptr && shareWeights)
+				tensor.data.view(info.data, info.count);
+			else if (info.data != nullptr)
+				tensor.data.assign(info.data, info.data + info.count);
 			else
-				throw std::runtime_error("Op not supported: " + name);
+				tensor.data.assign(shapeElementCount(tensor.shape), 0.0f);
+
+			// Mapped params get their grads on the first backward(): inference never touches them
+			if (!tensor.data.isView())
+				tensor.grad.assign(tensor.data.size(), 0.0f);
+
+			if (tensor.kind == "input")
+				inputId = tensor.id;
+			else if (tensor.kind == "target")
+				targetId = tensor.id;
+
+			tensors.push_back(std::move(tensor));
+		}
+
+		ops.reserve(bundle.ops().size());
+
+		for (const auto &info : bundle.ops())
+		{
+			Op op;
+			op.id = info.id;
+			op.op = std::string(info.op);
+			op.kernel = std::string(info.kernel);
+			op.inputs = info.inputs;
+			op.output = info.output;
+			op.axes = info.axes;
+			ops.push_back(std::move(op));
 		}
+
+		markBatchedTensors();
+		markTimedTensors();
+		reserveCapacity();
+
+		lossId = bundle.lossId();
+		outputId = bundle.outputId();
+		trainable = bundle.trainable();
+
+		if (shareWeights)
+			weightsMapping_ = std::move(bundlePtr);
+	}
+
+	void GraphRuntime::forward()
+	{
+		if (!profiling_)
+		{
+			for (const auto &op : ops)
+				forwardOp(op);
+			return;
+		}
+
+		for (std::size_t i = 0; i < ops.size(); ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			forwardOp(ops[i]);
+			recordOp(i, false, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+	}
+
+	void GraphRuntime::forwardOp(const Op &op)
+	{
+		const auto &name = op.op;
+		const auto &inputs = op.inputs;
+		const auto outId = op.output;
+
+		if (name == "matmul")
+			opMatmul(inputs[0], inputs[1], outId, op.kernel);
+		else if (name == "add")
+			opAdd(inputs[0], inputs[1], outId, op.kernel);
+		// else if (name == "sub")
+		// 	opSub(inputs[0], inputs[1], outId);
+		// else if (name == "dot")
+		// 	opDot(inputs[0], inputs[1], outId);
+		else if (name == "dropout")
+			opDropout(inputs[0], outId);
+		else if (name == "sig")
+			opSig(inputs[0], outId);
+		else if (name == "ReLU" || name == "relu")
+			opRelu(inputs[0], outId);
+		// else if (name == "LReLU")
+		// 	opLRelu(inputs[0], outId);
+		// else if (name == "MSE")
+		// 	opMse(inputs[0], outId);
+		// else if (name == "MAE")
+		// 	opMae(inputs[0], outId);
+		else if (name == "mean")
+			opMean(inputs[0], outId, op.kernel, op.axes);
+		else if (name == "softmax")
+			opSoftmax(inputs[0], outId, op.kernel, op.axes);
+		else if (name == "CE")
+			opCe(inputs[0], inputs[1], outId);
+		else if (name == "softmax_ce_logits")
+			opCeLogits(inputs[0], inputs[1], outId);
+		else if (name == "softmax_ce_logits_label_int")
+			opCeLogitsLabelInt(inputs[0], inputs[1], outId, op.kernel, op.axes);
+		else
+			throw std::runtime_error("Op not supported: " + name);
 	}
 
 	void GraphRuntime::backward()
 	{
+		if (forwardOnly_)
+			throw std::runtime_error("Execution contexts are forward only");
+
 		for (auto &tensor : tensors)
 		{
 			if (tensor.kind != "param")
 				tensor.grad.assign(tensor.grad.size(), 0.0f);
+			else if (tensor.grad.size() != tensor.data.size())
+				tensor.grad.assign(tensor.data.size(), 0.0f);
 		}
 
 		setLossGrad(1.0f);
 
-		for (int i = static_cast<int>(ops.size()) - 1; i >= 0; --i)
-		{
-			const auto &op = ops[static_cast<std::size_t>(i)];
-			const auto &name = op.op;
-			const auto &inputs = op.inputs;
-			auto outId = op.output;
-
-			if (name == "matmul")
-				backwardMatmul(inputs[0], inputs[1], outId, op.kernel);
-			else if (name == "add")
-				backwardAdd(inputs[0], inputs[1], outId, op.kernel);
-			// else if (name == "sub")
-			// 	backwardSub(inputs[0], inputs[1], outId);
-			// else if (name == "dot")
-			// 	backwardDot(inputs[0], inputs[1], outId);
-			else if (name == "dropout")
-				backwardDropout(inputs[0], outId);
-			else if (name == "sig")
-				backwardSig(inputs[0], outId);
-			else if (name == "relu" || name == "ReLU")
-				backwardRelu(inputs[0], outId);
-			// else if (name == "LReLU")
-			// 	backwardLRelu(inputs[0], outId);
-			// else if (name == "MSE")
-			// 	backwardMse(inputs[0], outId);
-			// else if (name == "MAE")
-			// 	backwardMae(inputs[0], outId);
-			else if (name == "mean")
-				backwardMean(inputs[0], outId, op.kernel, op.axes);
-			else if (name == "softmax")
-				backwardSoftmax(inputs[0], outId, op.kernel, op.axes);
-			else if (name == "CE")
-				backwardCe(inputs[0], inputs[1], outId);
-			else if (name == "softmax_ce_logits")
-				backwardCeLogits(inputs[0], inputs[1], outId);
-			else if (name == "softmax_ce_logits_label_int")
-				backwardCeLogitsLabelInt(inputs[0], inputs[1], outId, op.kernel, op.axes);
-			else
-				throw std::runtime_error("Op not supported: " + name);
+		if (!profiling_)
+		{
+			for (auto op = ops.rbegin(); op != ops.rend(); ++op)
+				backwardOp(*op);
+			return;
 		}
+
+		for (std::size_t i = ops.size(); i-- > 0;)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			backwardOp(ops[i]);
+			recordOp(i, true, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+	}
+
+	void GraphRuntime::backwardOp(const Op &op)
+	{
+		const auto &name = op.op;
+		const auto &inputs = op.inputs;
+		auto outId = op.output;
+
+		if (name == "matmul")
+			backwardMatmul(inputs[0], inputs[1], outId, op.kernel);
+		else if (name == "add")
+			backwardAdd(inputs[0], inputs[1], outId, op.kernel);
+		// else if (name == "sub")
+		// 	backwardSub(inputs[0], inputs[1], outId);
+		// else if (name == "dot")
+		// 	backwardDot(inputs[0], inputs[1], outId);
+		else if (name == "dropout")
+			backwardDropout(inputs[0], outId);
+		else if (name == "sig")
+			backwardSig(inputs[0], outId);
+		else if (name == "relu" || name == "ReLU")
+			backwardRelu(inputs[0], outId);
+		// else if (name == "LReLU")
+		// 	backwardLRelu(inputs[0], outId);
+		// else if (name == "MSE")
+		// 	backwardMse(inputs[0], outId);
+		// else if (name == "MAE")
+		// 	backwardMae(inputs[0], outId);
+		else if (name == "mean")
+			backwardMean(inputs[0], outId, op.kernel, op.axes);
+		else if (name == "softmax")
+			backwardSoftmax(inputs[0], outId, op.kernel, op.axes);
+		else if (name == "CE")
+			backwardCe(inputs[0], inputs[1], outId);
+		else if (name == "softmax_ce_logits")
+			backwardCeLogits(inputs[0], inputs[1], outId);
+		else if (name == "softmax_ce_logits_label_int")
+			backwardCeLogitsLabelInt(inputs[0], inputs[1], outId, op.kernel, op.axes);
+		else
+			throw std::runtime_error("Op not supported: " + name);
+	}
+
+	void GraphRuntime::setProfiling(bool enabled)
+	{
+		if (enabled && !profiler_)
+		{
+			profiler_ = std::make_unique<OpProfiler>();
+			for (const auto &op : ops)
+				profiler_->addOp(op.id, op.op, op.kernel);
+		}
+
+		profiling_ = enabled;
+	}
+
+	bool GraphRuntime::isProfiling() const
+	{
+		return profiling_;
+	}
+
+	const OpProfiler *GraphRuntime::profile() const
+	{
+		return profiler_.get();
+	}
+
+	void GraphRuntime::resetProfile()
+	{
+		if (profiler_)
+			profiler_->reset();
+	}
+
+	void GraphRuntime::recordOp(std::size_t index, bool backward, double seconds)
+	{
+		const auto &op = ops[index];
+		const auto outSize = static_cast<double>(tensors[op.output].data.size());
+
+		double inSize = 0.0;
+		for (int id : op.inputs)
+			inSize += static_cast<double>(tensors[id].data.size());
+
+		// Rough per-element costs: enough to rank kernels and compare them with peak rates
+		double flops = outSize;
+		if (op.op == "matmul")
+		{
+			const auto &a = tensors[op.inputs[0]];
+			flops = 2.0 * outSize * (a.shape.empty() ? 1.0 : static_cast<double>(a.shape.back()));
+		}
+		else if (op.op == "softmax")
+			flops = 5.0 * outSize;
+		else if (op.op == "sig")
+			flops = 4.0 * outSize;
+		else if (op.op == "mean")
+			flops = inSize;
+		else if (op.op == "CE" || op.op == "softmax_ce_logits" || op.op == "softmax_ce_logits_label_int")
+			flops = 5.0 * static_cast<double>(tensors[op.inputs[0]].data.size());
+
+		// Forward reads the inputs and writes the output; backward also reads the output gradient
+		// and accumulates into the input gradients
+		double bytes = (inSize + outSize) * sizeof(Scalar);
+		if (backward)
+		{
+			flops *= 2.0;
+			bytes = (2.0 * inSize + outSize) * sizeof(Scalar);
+		}
+
+		profiler_->record(index, backward, seconds, flops, bytes);
 	}
 
 	Tensor &GraphRuntime::getTensor(int id)
@@ -415,7 +598,7 @@ namespace PHP2xAI::Runtime::CPP
 	std::vector<Scalar> GraphRuntime::getLoss() const
 	{
 		const auto &tensor = tensors[lossId];
-		return tensor.data;
+		return tensor.data.toVector();
 	}
 	
 	Scalar GraphRuntime::getError() const
@@ -451,7 +634,7 @@ namespace PHP2xAI::Runtime::CPP
 			return data;
 		}
 		else
-			return tensor.data;
+			return tensor.data.toVector();
 	}
 	
 	void GraphRuntime::setLossGrad(Scalar lossGrad)
@@ -469,7 +652,7 @@ namespace PHP2xAI::Runtime::CPP
 		auto &tensor = tensors[inputId];
 
 		if (tensor.data.size() != x.size())
-			throw std::runtime_error("Inserting incompatible dimensions");
+			setBatchSize(batchSizeFor(tensor, x.size()));
 
 		tensor.data = x;
 	}
@@ -479,11 +662,144 @@ namespace PHP2xAI::Runtime::CPP
 		auto &tensor = tensors[targetId];
 
 		if (tensor.data.size() != y.size())
-			throw std::runtime_error("Inserting incompatible dimensions");
+			setBatchSize(batchSizeFor(tensor, y.size()));
 
 		tensor.data = y;
 	}
 
+	void GraphRuntime::swapInput(std::vector<Scalar> &x)
+	{
+		auto &tensor = tensors[inputId];
+
+		if (tensor.data.size() != x.size())
+			setBatchSize(batchSizeFor(tensor, x.size()));
+
+		tensor.data.swap(x);
+	}
+
+	void GraphRuntime::swapTarget(std::vector<Scalar> &y)
+	{
+		auto &tensor = tensors[targetId];
+
+		if (tensor.data.size() != y.size())
+			setBatchSize(batchSizeFor(tensor, y.size()));
+
+		tensor.data.swap(y);
+	}
+
+	void GraphRuntime::setTensorData(int id, const Scalar *x, std::size_t n)
+	{
+		auto &tensor = getTensor(id);
+
+		if (tensor.data.size() != n && tensor.batched)
+			setBatchSize(batchSizeFor(tensor, n));
+
+		if (tensor.data.size() != n)
+			throw std::runtime_error("Inserting incompatible dimensions");
+
+		std::copy(x, x + n, tensor.data.begin());
+	}
+
+	void GraphRuntime::setBatchSize(int batchSize)
+	{
+		if (batchSize == batchSize_)
+			return;
+
+		if (batchSize < 1 || batchSize > maxBatchSize_)
+			throw std::runtime_error("Batch size " + std::to_string(batchSize)
+				+ " out of range (max " + std::to_string(maxBatchSize_) + ")");
+
+		// Only the leading extent changes: strides and the reserved capacity stay valid
+		for (auto &tensor : tensors)
+		{
+			if (!tensor.batched)
+				continue;
+
+			const auto size = sampleSize(tensor.id) * static_cast<std::size_t>(batchSize);
+			tensor.shape[0] = batchSize;
+			tensor.data.resize(size, 0.0f);
+			if (!forwardOnly_)
+				tensor.grad.resize(size, 0.0f);
+		}
+
+		batchSize_ = batchSize;
+	}
+
+	int GraphRuntime::getBatchSize() const
+	{
+		return batchSize_;
+	}
+
+	int GraphRuntime::getMaxBatchSize() const
+	{
+		return maxBatchSize_;
+	}
+
+	void GraphRuntime::setSequenceLength(int steps)
+	{
+		if (steps == seqLen_)
+			return;
+
+		if (maxSeqLen_ == 0)
+			throw std::runtime_error("Graph has no sequence axis");
+
+		if (steps < 1 || steps > maxSeqLen_)
+			throw std::runtime_error("Sequence length " + std::to_string(steps)
+				+ " out of range (max " + std::to_string(maxSeqLen_) + ")");
+
+		// The time axes are not the leading one: strides change with them
+		for (auto &tensor : tensors)
+		{
+			if (tensor.timeAxes.empty())
+				continue;
+
+			for (int axis : tensor.timeAxes)
+				tensor.shape[static_cast<std::size_t>(axis)] = steps;
+			tensor.strides = Tensor::computeStrides(tensor.shape);
+
+			const auto size = shapeElementCount(tensor.shape);
+			tensor.data.resize(size, 0.0f);
+			if (!forwardOnly_)
+				tensor.grad.resize(size, 0.0f);
+		}
+
+		seqLen_ = steps;
+	}
+
+	int GraphRuntime::getSequenceLength() const
+	{
+		return seqLen_;
+	}
+
+	int GraphRuntime::getMaxSequenceLength() const
+	{
+		return maxSeqLen_;
+	}
+
+	std::size_t GraphRuntime::sampleSize(int id) const
+	{
+		const auto &tensor = getTensor(id);
+
+		if (!tensor.batched)
+			return shapeElementCount(tensor.shape);
+
+		std::size_t count = 1;
+		for (std::size_t a = 1; a < tensor.shape.size(); ++a)
+			count *= static_cast<std::size_t>(tensor.shape[a]);
+		return count;
+	}
+
+	int GraphRuntime::batchSizeFor(const Tensor &tensor, std::size_t size) const
+	{
+		const auto rowSize = sampleSize(tensor.id);
+
+		if (!tensor.batched || rowSize == 0 || size == 0 || size % rowSize != 0
+			|| size / rowSize > static_cast<std::size_t>(maxBatchSize_))
+			throw std::runtime_error("Inserting incompatible dimensions");
+
+		return static_cast<int>(size / rowSize);
+	}
+
 	void GraphRuntime::resetGrad()
 	{
 		for (auto &tensor : tensors)
@@ -515,28 +831,95 @@ namespace PHP2xAI::Runtime::CPP
 
 	void GraphRuntime::saveWeightsToJson(const std::string &path) const
 	{
-		nlohmann::json tensorsJson = nlohmann::json::object();
+		writeWeights(path, trainableTensors(), false);
+	}
+
+	void GraphRuntime::saveWeightsToBinary(const std::string &path) const
+	{
+		writeWeights(path, trainableTensors(), true);
+	}
+
+	void GraphRuntime::saveWeights(const std::string &path) const
+	{
+		writeWeights(path, trainableTensors(), isBinaryWeightsPath(path));
+	}
+
+	std::vector<const Tensor *> GraphRuntime::trainableTensors() const
+	{
+		std::vector<const Tensor *> weights;
 
 		for (const auto &t : tensors)
 		{
 			if (std::find(trainable.begin(), trainable.end(), t.id) != trainable.end())
-			{
-				tensorsJson[std::to_string(t.id)] = {
-					{"data", t.data},
-					{"shape", t.shape}
-				};
-			}
+				weights.push_back(&t);
 		}
 
-		nlohmann::json jsonArray = {
-			{"tensors", std::move(tensorsJson)}
-		};
+		return weights;
+	}
+
+	bool GraphRuntime::isBinaryWeightsPath(const std::string &path)
+	{
+		const std::string ext = ".bin";
+
+		return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+	}
+
+	void GraphRuntime::writeWeights(const std::string &path, const std::vector<const Tensor *> &weights, bool binary)
+	{
+		if (binary)
+			return WeightsFile::write(path, weights);
 
 		std::ofstream file(path, std::ios::trunc);
 		if (!file.is_open())
 			throw std::runtime_error("Unable to open file for writing: " + path);
 
-		file << jsonArray.dump();
+		writeWeights(file, weights, false);
+
+		if (!file)
+			throw std::runtime_error("Unable to write weights file: " + path);
+	}
+
+	void GraphRuntime::writeWeights(std::ostream &out, const std::vector<const Tensor *> &weights, bool binary)
+	{
+		if (binary)
+			return WeightsFile::write(out, weights);
+
+		// Same layout as the old DOM dump ({"tensors": {"<id>": {"data", "shape"}}}), written value
+		// by value: shortest round-trip float text, non-finite values as null like nlohmann does
+		char buffer[32];
+
+		out << "{\"tensors\":{";
+
+		for (std::size_t i = 0; i < weights.size(); ++i)
+		{
+			const auto &t = *weights[i];
+
+			out << (i > 0 ? "," : "") << '"' << t.id << "\":{\"data\":[";
+
+			for (std::size_t k = 0; k < t.data.size(); ++k)
+			{
+				if (k > 0)
+					out.put(',');
+
+				if (!std::isfinite(t.data[k]))
+				{
+					out << "null";
+					continue;
+				}
+
+				const auto res = std::to_chars(buffer, buffer + sizeof(buffer), t.data[k]);
+				out.write(buffer, res.ptr - buffer);
+			}
+
+			out << "],\"shape\":[";
+
+			for (std::size_t a = 0; a < t.shape.size(); ++a)
+				out << (a > 0 ? "," : "") << t.shape[a];
+
+			out << "]}";
+		}
+
+		out << "}}";
 	}
 
 	void GraphRuntime::opMatmul(int aId, int bId, int outId, const std::string &kernel)
@@ -1162,7 +1545,7 @@ namespace PHP2xAI::Runtime::CPP
 		if (classes == 0 || classes != target.data.size())
 		{
 			out.shape.clear();
-			out.data = {0.0f};
+			out.data.assign(1, 0.0f);
 			return;
 		}
 
@@ -1257,7 +1640,7 @@ namespace PHP2xAI::Runtime::CPP
 		if (isOneHot && activeIndex != -1)
 		{
 			Scalar prob = activeIndex < static_cast<int>(pred.data.size()) ? pred.data[static_cast<std::size_t>(activeIndex)] : 0.0f;
-			out.data = {-std::log(prob + eps)};
+			out.data.assign(1, -std::log(prob + eps));
 			return;
 		}
 
@@ -1266,7 +1649,7 @@ namespace PHP2xAI::Runtime::CPP
 		for (std::size_t i = 0; i < classes; ++i)
 			loss += target.data[i] * std::log((pred.data[i]) + eps);
 
-		out.data = {-loss};
+		out.data.assign(1, -loss);
 	}
 
 	void GraphRuntime::opCeLogits(int logitsId, int targetId, int outId)
@@ -1280,7 +1663,7 @@ namespace PHP2xAI::Runtime::CPP
 		if (classes == 0 || classes != target.data.size())
 		{
 			out.shape.clear();
-			out.data = {0.0f};
+			out.data.assign(1, 0.0f);
 			return;
 		}
 
@@ -1367,7 +1750,7 @@ namespace PHP2xAI::Runtime::CPP
 				loss += -t * std::log(probs[i] + eps);
 		}
 
-		out.data = {loss};
+		out.data.assign(1, loss);
 	}
 
 	void GraphRuntime::opCeLogitsLabelInt(int logitsId, int targetId, int outId, const std::string &kernel, const std::vector<int> &axes)
@@ -1381,7 +1764,7 @@ namespace PHP2xAI::Runtime::CPP
 		{
 			out.shape.clear();
 			out.strides.clear();
-			out.data = {0.0f};
+			out.data.assign(1, 0.0f);
 			return;
 		}
 
@@ -1389,15 +1772,34 @@ namespace PHP2xAI::Runtime::CPP
 		const int axis = axes.empty() ? -1 : axes[0];
 
 		if (selectedKernel == "CE_LOGITS_LABEL_INT_1D_LAST")
-			return CE_LOGITS_LABEL_INT_1D_LAST(logits, target, out);
-		if (selectedKernel == "CE_LOGITS_LABEL_INT_2D_LAST")
-			return CE_LOGITS_LABEL_INT_2D_LAST(logits, target, out);
-		if (selectedKernel == "CE_LOGITS_LABEL_INT_3D_LAST")
-			return CE_LOGITS_LABEL_INT_3D_LAST(logits, target, out);
-		if (selectedKernel == "CE_LOGITS_LABEL_INT_GENERIC_AXIS")
-			return CE_LOGITS_LABEL_INT_GENERIC_AXIS(logits, target, out, axis);
+			CE_LOGITS_LABEL_INT_1D_LAST(logits, target, out);
+		else if (selectedKernel == "CE_LOGITS_LABEL_INT_2D_LAST")
+			CE_LOGITS_LABEL_INT_2D_LAST(logits, target, out);
+		else if (selectedKernel == "CE_LOGITS_LABEL_INT_3D_LAST")
+			CE_LOGITS_LABEL_INT_3D_LAST(logits, target, out);
+		else if (selectedKernel == "CE_LOGITS_LABEL_INT_GENERIC_AXIS")
+			CE_LOGITS_LABEL_INT_GENERIC_AXIS(logits, target, out, axis);
+		else
+			throw std::runtime_error("CE logits label int: kernel not supported");
 
-		throw std::runtime_error("CE logits label int: kernel not supported");
+		const auto weight = validLabelWeight(target);
+		if (weight != 1.0f)
+		{
+			for (auto &v : out.data)
+				v *= weight;
+		}
+	}
+
+	Scalar GraphRuntime::validLabelWeight(const Tensor &target) const
+	{
+		std::size_t valid = 0;
+		for (auto label : target.data)
+			valid += label < 0.0f ? 0 : 1;
+
+		if (valid == 0 || valid == target.data.size())
+			return 1.0f;
+
+		return static_cast<Scalar>(target.data.size()) / static_cast<Scalar>(valid);
 	}
 
 	void GraphRuntime::CE_LOGITS_LABEL_INT_1D_LAST(Tensor &logits, Tensor &target, Tensor &out)
@@ -1412,6 +1814,13 @@ namespace PHP2xAI::Runtime::CPP
 		Scalar maxVal = logits.data[0];
 		const int labelInt = target.data.empty() ? 0 : static_cast<int>(target.data[0]);
 
+		// Negative label: masked (padding) position, zero loss and zero gradient
+		if (labelInt < 0)
+		{
+			out.data.assign(1, 0.0f);
+			return;
+		}
+
 		for (std::size_t i = 1; i < classes; ++i)
 			if (logits.data[i] > maxVal)
 				maxVal = logits.data[i];
@@ -1420,7 +1829,7 @@ namespace PHP2xAI::Runtime::CPP
 		for (std::size_t i = 0; i < classes; ++i)
 			sumExp += std::exp(logits.data[i] - maxVal);
 
-		out.data = {std::log(sumExp) + maxVal - logits.data[static_cast<std::size_t>(labelInt)]};
+		out.data.assign(1, std::log(sumExp) + maxVal - logits.data[static_cast<std::size_t>(labelInt)]);
 	}
 
 	void GraphRuntime::CE_LOGITS_LABEL_INT_2D_LAST(Tensor &logits, Tensor &target, Tensor &out)
@@ -1442,6 +1851,9 @@ namespace PHP2xAI::Runtime::CPP
 		{
 			const int rowStart = b * dim;
 			const int labelInt = static_cast<int>(target.data[static_cast<std::size_t>(b)]);
+			if (labelInt < 0)
+				continue;
+
 			Scalar maxVal = logits.data[static_cast<std::size_t>(rowStart)];
 
 			for (int i = 1; i < dim; ++i)
@@ -1486,6 +1898,9 @@ namespace PHP2xAI::Runtime::CPP
 				const int rowStart = batchBase + t * dim;
 				const int outPos = outBase + t;
 				const int labelInt = static_cast<int>(target.data[static_cast<std::size_t>(outPos)]);
+				if (labelInt < 0)
+					continue;
+
 				Scalar maxVal = logits.data[static_cast<std::size_t>(rowStart)];
 
 				for (int i = 1; i < dim; ++i)
@@ -1546,6 +1961,12 @@ namespace PHP2xAI::Runtime::CPP
 				}
 
 				const int labelInt = static_cast<int>(target.data[static_cast<std::size_t>(targetBase)]);
+				if (labelInt < 0)
+				{
+					++outPos;
+					return;
+				}
+
 				Scalar maxVal = logits.data[static_cast<std::size_t>(base)];
 				int off = base + strideAxis;
 
@@ -1600,7 +2021,7 @@ namespace PHP2xAI::Runtime::CPP
 		Scalar mean = std::accumulate(A.data.begin(), A.data.end(), 0.0f)
 			/ static_cast<Scalar>(A.data.size());
 
-		out.data = {mean};
+		out.data.assign(1, mean);
 	}
 
 	void GraphRuntime::MEAN_2D_FIRST(Tensor &A, Tensor &out)
@@ -2774,14 +3195,16 @@ namespace PHP2xAI::Runtime::CPP
 		const std::string selectedKernel = kernel.empty() ? "CE_LOGITS_LABEL_INT_GENERIC_AXIS" : kernel;
 		const int axis = axes.empty() ? -1 : axes[0];
 
+		const auto weight = validLabelWeight(target);
+
 		if (selectedKernel == "CE_LOGITS_LABEL_INT_1D_LAST")
 			return BACKWORD_CE_LOGITS_LABEL_INT_1D_LAST(logits, target, out);
 		if (selectedKernel == "CE_LOGITS_LABEL_INT_2D_LAST")
-			return BACKWORD_CE_LOGITS_LABEL_INT_2D_LAST(logits, target, out);
+			return BACKWORD_CE_LOGITS_LABEL_INT_2D_LAST(logits, target, out, weight);
 		if (selectedKernel == "CE_LOGITS_LABEL_INT_3D_LAST")
-			return BACKWORD_CE_LOGITS_LABEL_INT_3D_LAST(logits, target, out);
+			return BACKWORD_CE_LOGITS_LABEL_INT_3D_LAST(logits, target, out, weight);
 		if (selectedKernel == "CE_LOGITS_LABEL_INT_GENERIC_AXIS")
-			return BACKWORD_CE_LOGITS_LABEL_INT_GENERIC_AXIS(logits, target, out, axis);
+			return BACKWORD_CE_LOGITS_LABEL_INT_GENERIC_AXIS(logits, target, out, axis, weight);
 
 		throw std::runtime_error("CE logits label int backward: kernel not supported");
 	}
@@ -2796,6 +3219,9 @@ namespace PHP2xAI::Runtime::CPP
 		const int labelInt = target.data.empty() ? 0 : static_cast<int>(target.data[0]);
 		Scalar maxVal = logits.data[0];
 
+		if (labelInt < 0)
+			return;
+
 		for (std::size_t i = 1; i < classes; ++i)
 			if (logits.data[i] > maxVal)
 				maxVal = logits.data[i];
@@ -2815,7 +3241,7 @@ namespace PHP2xAI::Runtime::CPP
 		}
 	}
 
-	void GraphRuntime::BACKWORD_CE_LOGITS_LABEL_INT_2D_LAST(Tensor &logits, Tensor &target, Tensor &out)
+	void GraphRuntime::BACKWORD_CE_LOGITS_LABEL_INT_2D_LAST(Tensor &logits, Tensor &target, Tensor &out, Scalar weight)
 	{
 		if (logits.shape.size() != 2)
 			throw std::runtime_error("CE logits label int 2D backward: dimension mismatch");
@@ -2830,6 +3256,9 @@ namespace PHP2xAI::Runtime::CPP
 		{
 			const int rowStart = b * dim;
 			const int labelInt = static_cast<int>(target.data[static_cast<std::size_t>(b)]);
+			if (labelInt < 0)
+				continue;
+
 			Scalar maxVal = logits.data[static_cast<std::size_t>(rowStart)];
 
 			for (int i = 1; i < dim; ++i)
@@ -2845,7 +3274,7 @@ namespace PHP2xAI::Runtime::CPP
 
 			const Scalar invSum = sumExp > 0.0f ? 1.0f / sumExp : 0.0f;
 			const Scalar scale = static_cast<std::size_t>(b) < out.grad.size()
-				? out.grad[static_cast<std::size_t>(b)]
+				? out.grad[static_cast<std::size_t>(b)] * weight
 				: 0.0f;
 
 			for (int i = 0; i < dim; ++i)
@@ -2859,7 +3288,7 @@ namespace PHP2xAI::Runtime::CPP
 		}
 	}
 
-	void GraphRuntime::BACKWORD_CE_LOGITS_LABEL_INT_3D_LAST(Tensor &logits, Tensor &target, Tensor &out)
+	void GraphRuntime::BACKWORD_CE_LOGITS_LABEL_INT_3D_LAST(Tensor &logits, Tensor &target, Tensor &out, Scalar weight)
 	{
 		if (logits.shape.size() != 3)
 			throw std::runtime_error("CE logits label int 3D backward: dimension mismatch");
@@ -2881,6 +3310,9 @@ namespace PHP2xAI::Runtime::CPP
 				const int rowStart = batchBase + t * dim;
 				const int outPos = outBase + t;
 				const int labelInt = static_cast<int>(target.data[static_cast<std::size_t>(outPos)]);
+				if (labelInt < 0)
+					continue;
+
 				Scalar maxVal = logits.data[static_cast<std::size_t>(rowStart)];
 
 				for (int i = 1; i < dim; ++i)
@@ -2896,7 +3328,7 @@ namespace PHP2xAI::Runtime::CPP
 
 				const Scalar invSum = sumExp > 0.0f ? 1.0f / sumExp : 0.0f;
 				const Scalar scale = static_cast<std::size_t>(outPos) < out.grad.size()
-					? out.grad[static_cast<std::size_t>(outPos)]
+					? out.grad[static_cast<std::size_t>(outPos)] * weight
 					: 0.0f;
 
 				for (int i = 0; i < dim; ++i)
@@ -2911,7 +3343,7 @@ namespace PHP2xAI::Runtime::CPP
 		}
 	}
 
-	void GraphRuntime::BACKWORD_CE_LOGITS_LABEL_INT_GENERIC_AXIS(Tensor &logits, Tensor &target, Tensor &out, int axis)
+	void GraphRuntime::BACKWORD_CE_LOGITS_LABEL_INT_GENERIC_AXIS(Tensor &logits, Tensor &target, Tensor &out, int axis, Scalar weight)
 	{
 		const int rank = static_cast<int>(logits.shape.size());
 		if (rank == 0)
@@ -2948,6 +3380,12 @@ namespace PHP2xAI::Runtime::CPP
 				}
 
 				const int labelInt = static_cast<int>(target.data[static_cast<std::size_t>(targetBase)]);
+				if (labelInt < 0)
+				{
+					++outPos;
+					return;
+				}
+
 				Scalar maxVal = logits.data[static_cast<std::size_t>(base)];
 				int off = base + strideAxis;
 
@@ -2968,7 +3406,7 @@ namespace PHP2xAI::Runtime::CPP
 				}
 
 				const Scalar invSum = sumExp > 0.0f ? 1.0f / sumExp : 0.0f;
-				const Scalar scale = outPos < out.grad.size() ? out.grad[outPos] : 0.0f;
+				const Scalar scale = outPos < out.grad.size() ? out.grad[outPos] * weight : 0.0f;
 				++outPos;
 
 				off = base;
@@ -3082,12 +3520,12 @@ namespace PHP2xAI::Runtime::CPP
 	}
 
 	void GraphRuntime::addAlongAxisInPlace(
-		std::vector<Scalar> &zData,
+		TensorStorage &zData,
 		const std::vector<int> &zShape,
 		const std::vector<int> &zStrides,
-		const std::vector<Scalar> &xData,
+		const TensorStorage &xData,
 		const std::vector<int> &xStrides,
-		const std::vector<Scalar> &yData,
+		const TensorStorage &yData,
 		const std::vector<int> &yStrides,
 		int axis) const
 	{
@@ -3143,7 +3581,7 @@ namespace PHP2xAI::Runtime::CPP
 	}
 
 	void GraphRuntime::softmaxAlongAxisInPlace(
-		std::vector<Scalar> &data,
+		TensorStorage &data,
 		const std::vector<int> &shape,
 		const std::vector<int> &strides,
 		int axis) const
@@ -3202,25 +3640,63 @@ namespace PHP2xAI::Runtime::CPP
 			});
 	}
 
-	json GraphRuntime::loadJson(const std::string &path)
+	std::unique_ptr<GraphRuntime> GraphRuntime::createContext() const
 	{
-		std::ifstream file(path);
+		std::unique_ptr<GraphRuntime> context(new GraphRuntime());
 
-		if (!file.is_open())
-			throw std::runtime_error("Unable to open graph file: " + path);
+		context->ops = ops;
+		context->lossId = lossId;
+		context->trainable = trainable;
+		context->inputId = inputId;
+		context->targetId = targetId;
+		context->outputId = outputId;
+		context->graphPath_ = graphPath_;
+		context->batchSize_ = batchSize_;
+		context->maxBatchSize_ = maxBatchSize_;
+		context->seqLen_ = seqLen_;
+		context->maxSeqLen_ = maxSeqLen_;
+		context->forwardOnly_ = true;
+		context->weightsMapping_ = weightsMapping_;
+
+		context->tensors.resize(tensors.size());
+
+		for (std::size_t i = 0; i < tensors.size(); ++i)
+		{
+			const auto &src = tensors[i];
+			auto &dst = context->tensors[i];
+
+			dst.id = src.id;
+			dst.shape = src.shape;
+			dst.name = src.name;
+			dst.kind = src.kind;
+			dst.baseOffset = src.baseOffset;
+			dst.strides = src.strides;
+			dst.batched = src.batched;
+			dst.timeAxes = src.timeAxes;
 
-		json parsed;
-		file >> parsed;
-		return parsed;
+			if (src.kind == "param")
+				dst.data.view(src.data.data(), src.data.size());
+			else
+				dst.data = src.data;
+		}
+
+		return context;
+	}
+
+	bool GraphRuntime::isContext() const
+	{
+		return forwardOnly_;
 	}
 
-	void GraphRuntime::loadTensors(const json &graphDef, const json *weightsDef)
+	void GraphRuntime::loadTensors(const json &graphDef, TensorDataMap &graphData, JsonLoader::Document *weightsDef, const WeightsFile *weightsBin, bool shareWeights)
 	{
 		const auto &jsonTensors = graphDef.at("tensors");
 		tensors.reserve(jsonTensors.size());
 
-		for (const auto &t : jsonTensors)
+		for (std::size_t i = 0; i < jsonTensors.size(); ++i)
 		{
+			const auto &t = jsonTensors[i];
+
 			Tensor tensor;
 			tensor.id = t.at("id").get<int>();
 			tensor.kind = t.at("kind").get<std::string>();
@@ -3230,7 +3706,15 @@ namespace PHP2xAI::Runtime::CPP
 			tensor.strides = Tensor::computeStrides(tensor.shape);
 
 			// Initialize data/grad; if data provided, use it, otherwise fill zeros with shape product (or 1).
-			if (t.contains("data"))
+			// Data streamed by JsonLoader is moved in as is, a DOM graph still goes through get<>.
+			const auto streamed = graphData.find(std::to_string(i));
+
+			if (streamed != graphData.end())
+			{
+				tensor.data = std::move(streamed->second);
+				graphData.erase(streamed);
+			}
+			else if (t.contains("data"))
 			{
 				tensor.data = t.at("data").get<std::vector<Scalar>>();
 			}
@@ -3244,22 +3728,39 @@ namespace PHP2xAI::Runtime::CPP
 				tensor.data.assign(size, 0.0f);
 			}
 
-			if (weightsDef != nullptr && tensor.kind == "param" && weightsDef->contains("tensors"))
+			if (weightsDef != nullptr && tensor.kind == "param" && weightsDef->doc.contains("tensors"))
 			{
-				const auto &weightsTensors = weightsDef->at("tensors");
+				const auto &weightsTensors = weightsDef->doc.at("tensors");
 				const auto tensorKey = std::to_string(tensor.id);
 
 				if (weightsTensors.contains(tensorKey))
 				{
 					const auto &weightsTensor = weightsTensors.at(tensorKey);
 					const auto weightsShape = weightsTensor.at("shape").get<std::vector<int>>();
+					const auto weightsData = weightsDef->tensorData.find(tensorKey);
 
-					if (weightsShape == tensor.shape)
-						tensor.data = weightsTensor.at("data").get<std::vector<Scalar>>();
+					if (weightsShape == tensor.shape && weightsData != weightsDef->tensorData.end())
+					{
+						tensor.data = std::move(weightsData->second);
+						weightsDef->tensorData.erase(weightsData);
+					}
 				}
 			}
 
-			tensor.grad.assign(tensor.data.size(), 0.0f);
+			if (weightsBin != nullptr && tensor.kind == "param")
+			{
+				// Straight copy out of the mapping, or no copy at all when shared: no parsing, only
+				// this tensor's pages are touched
+				const auto *entry = weightsBin->find(tensor.id);
+
+				if (entry != nullptr && entry->shape == tensor.shape && shareWeights)
+					tensor.data.view(entry->data, entry->count);
+				else if (entry != nullptr && entry->shape == tensor.shape)
+					tensor.data.assign(entry->data, entry->data + entry->count);
+			}
+
+			if (!tensor.data.isView())
+				tensor.grad.assign(tensor.data.size(), 0.0f);
 
 			if (tensor.kind == "input")
 				inputId = tensor.id;
@@ -3294,4 +3795,289 @@ namespace PHP2xAI::Runtime::CPP
 			ops.push_back(std::move(op));
 		}
 	}
+
+	void GraphRuntime::markBatchedTensors()
+	{
+		if (tensors.empty())
+			return;
+
+		auto &input = tensors[inputId];
+
+		if (input.kind != "input" || input.shape.empty() || input.shape[0] < 1)
+			return;
+
+		// Axis 0 is the batch only next to a sample axis: a rank-1 input ([C]) is one sample unless the graph says "batched"
+		if (!graphDef_.value("batched", input.getRank() >= 2))
+			return;
+
+		const int batch = input.shape[0];
+		batchSize_ = batch;
+		maxBatchSize_ = std::max(batch, graphDef_.value("max_batch_size", batch));
+
+		input.batched = true;
+
+		// B follows each op's axis mapping; extents are never matched, so a [C] tensor with C == B stays unbatched
+		for (const auto &op : ops)
+		{
+			auto &out = tensors[op.output];
+
+			if (keepsBatchAxis(op))
+			{
+				if (out.shape.empty() || out.shape[0] != batch)
+					throw std::runtime_error("Op " + std::to_string(op.id) + " (" + op.op
+						+ "): axis 0 does not match the batch size");
+
+				out.batched = true;
+			}
+
+			// Labels are laid out like the loss, one-hot and soft targets like the logits
+			if (op.inputs.size() > 1 && op.inputs[1] == targetId && !tensors[targetId].batched)
+			{
+				auto &target = tensors[targetId];
+				const bool batchedTarget = op.op == "softmax_ce_logits_label_int"
+					? tensors[op.inputs[0]].batched && target.getRank() > 0 && reducedAxisOf(op) != 0
+					: (op.op == "CE" || op.op == "softmax_ce_logits") && tensors[op.inputs[0]].batched;
+
+				if (!batchedTarget)
+					continue;
+
+				if (target.shape.empty() || target.shape[0] != batch)
+					throw std::runtime_error("Op " + std::to_string(op.id) + " (" + op.op
+						+ "): target axis 0 does not match the batch size");
+
+				target.batched = true;
+			}
+		}
+	}
+
+	bool GraphRuntime::keepsBatchAxis(const Op &op) const
+	{
+		const auto &a = tensors[op.inputs[0]];
+		const int rankA = a.getRank();
+		const int rankOut = tensors[op.output].getRank();
+
+		if (op.op == "matmul")
+		{
+			// Axis 0 of A is a batch axis or M, axis 0 of B a batch axis from rank 3; the rank-1 and B = [K, N] forms contract it
+			const auto &b = tensors[op.inputs[1]];
+			const int rankB = b.getRank();
+
+			return (a.batched && rankA >= 2 && rankA == rankOut) || (b.batched && rankB >= 3 && rankB == rankOut);
+		}
+
+		if (op.op == "add")
+		{
+			// B broadcasts over the trailing axes of A, so only a B of full rank owns axis 0
+			const auto &b = tensors[op.inputs[1]];
+			return (a.batched && rankA == rankOut) || (b.batched && b.getRank() == rankOut);
+		}
+
+		if (!a.batched)
+			return false;
+
+		if (op.op == "mean" || op.op == "softmax_ce_logits_label_int")
+			return rankOut > 0 && reducedAxisOf(op) != 0;
+
+		if (op.op == "CE" || op.op == "softmax_ce_logits")
+		{
+			// Per-row loss over the class (last) axis, or a scalar
+			return rankOut > 0 && rankOut == rankA - 1;
+		}
+
+		// Element-wise ops and softmax keep the shape
+		return true;
+	}
+
+	int GraphRuntime::reducedAxisOf(const Op &op) const
+	{
+		// Axis removed by mean (first, or the attribute) and by the label CE (class axis: last, or the attribute)
+		const int rank = tensors[op.inputs[0]].getRank();
+		const bool labels = op.op == "softmax_ce_logits_label_int";
+		const bool generic = op.kernel.empty() || op.kernel == (labels ? "CE_LOGITS_LABEL_INT_GENERIC_AXIS" : "MEAN_GENERIC_AXIS");
+
+		if (!generic)
+			return labels ? rank - 1 : 0;
+
+		const int axis = op.axes.empty() ? (labels ? -1 : 0) : op.axes[0];
+		return axis < 0 ? axis + rank : axis;
+	}
+
+	void GraphRuntime::markTimedTensors()
+	{
+		if (tensors.empty())
+			return;
+
+		const auto &input = tensors[inputId];
+
+		// Only [B, T, D] inputs carry a sequence axis
+		if (!input.batched || input.getRank() < 3 || input.shape[1] < 1)
+			return;
+
+		const int steps = input.shape[1];
+		seqLen_ = steps;
+		maxSeqLen_ = std::max(steps, graphDef_.value("max_sequence_length", steps));
+
+		tensors[inputId].timeAxes = {1};
+
+		// T follows each op's axis mapping; extents are never matched, so a [B, D] tensor with D == T stays untimed
+		for (const auto &op : ops)
+		{
+			auto axes = timeAxesOf(op);
+			auto &out = tensors[op.output];
+
+			for (int axis : axes)
+			{
+				if (axis >= out.getRank() || out.shape[static_cast<std::size_t>(axis)] != steps)
+					throw std::runtime_error("Op " + std::to_string(op.id) + " (" + op.op
+						+ "): time axis " + std::to_string(axis) + " does not match the sequence length");
+			}
+
+			out.timeAxes = std::move(axes);
+
+			// Labels are laid out like the loss, one-hot and soft targets like the logits
+			if (op.inputs.size() > 1 && op.inputs[1] == targetId && tensors[targetId].batched && tensors[targetId].timeAxes.empty())
+			{
+				if (op.op == "softmax_ce_logits_label_int")
+					tensors[targetId].timeAxes = out.timeAxes;
+				else if (op.op == "CE" || op.op == "softmax_ce_logits")
+					tensors[targetId].timeAxes = tensors[op.inputs[0]].timeAxes;
+			}
+		}
+	}
+
+	std::vector<int> GraphRuntime::timeAxesOf(const Op &op) const
+	{
+		const auto &a = tensors[op.inputs[0]];
+		const auto &out = tensors[op.output];
+		const int rankA = a.getRank();
+		const int rankOut = out.getRank();
+		std::vector<int> axes;
+
+		// Maps an axis of A (or B) onto the output after removing `dropped` (-1: none)
+		const auto keep = [&axes](const Tensor &tensor, int shift, int dropped)
+		{
+			for (int axis : tensor.timeAxes)
+			{
+				if (axis == dropped)
+					continue;
+				axes.push_back(axis > dropped && dropped >= 0 ? axis - 1 + shift : axis + shift);
+			}
+		};
+
+		if (op.op == "matmul")
+		{
+			// [..., M, K] x [..., K, N]: batch axes align from the right, M comes from A, N from B, K is contracted
+			const auto &b = tensors[op.inputs[1]];
+			const int rankB = b.getRank();
+
+			for (int axis : a.timeAxes)
+			{
+				if (axis != rankA - 1)
+					axes.push_back(axis + rankOut - rankA);
+			}
+
+			for (int axis : b.timeAxes)
+			{
+				if (axis == rankB - 1)
+					axes.push_back(rankOut - 1);
+				else if (axis < rankB - 2)
+					axes.push_back(axis + rankOut - rankB);
+			}
+		}
+		else if (op.op == "add")
+		{
+			// B broadcasts over the trailing axes of A
+			keep(a, 0, -1);
+			keep(tensors[op.inputs[1]], rankOut - tensors[op.inputs[1]].getRank(), -1);
+		}
+		else if (op.op == "mean" || op.op == "softmax_ce_logits_label_int")
+		{
+			keep(a, 0, reducedAxisOf(op));
+		}
+		else if (op.op == "CE" || op.op == "softmax_ce_logits")
+		{
+			// Per-row loss over the class (last) axis, or a scalar
+			if (rankOut == rankA - 1)
+				keep(a, 0, rankA - 1);
+		}
+		else
+		{
+			// Element-wise ops and softmax keep the shape
+			keep(a, 0, -1);
+		}
+
+		std::sort(axes.begin(), axes.end());
+		axes.erase(std::unique(axes.begin(), axes.end()), axes.end());
+
+		return axes;
+	}
+
+	const Op *GraphRuntime::timeMixingOp() const
+	{
+		// Positions with label -1 add nothing to the label CE output, and the valid ones are already scaled to their mean
+		std::vector<bool> masked(tensors.size(), false);
+
+		for (const auto &op : ops)
+		{
+			const auto &a = tensors[op.inputs[0]];
+			const int rankA = a.getRank();
+			bool mixes = false;
+
+			if (op.op == "softmax")
+			{
+				const bool generic = op.kernel.empty() || op.kernel == "SOFTMAX_GENERIC_AXIS";
+				const int axis = generic && !op.axes.empty() ? op.axes[0] : -1;
+				mixes = a.isTimeAxis(axis < 0 ? axis + rankA : axis);
+			}
+			else if (op.op == "matmul")
+			{
+				// K is the last axis of A and the second to last of B
+				const auto &b = tensors[op.inputs[1]];
+				mixes = a.isTimeAxis(rankA - 1) || (b.getRank() >= 2 && b.isTimeAxis(b.getRank() - 2));
+			}
+			else if (op.op == "mean")
+			{
+				mixes = !masked[static_cast<std::size_t>(a.id)] && a.isTimeAxis(reducedAxisOf(op));
+				masked[static_cast<std::size_t>(op.output)] = masked[static_cast<std::size_t>(a.id)];
+			}
+			else if (op.op == "softmax_ce_logits_label_int")
+			{
+				mixes = a.isTimeAxis(reducedAxisOf(op));
+				masked[static_cast<std::size_t>(op.output)] = true;
+			}
+			else if (op.op == "CE" || op.op == "softmax_ce_logits")
+			{
+				// Class axis, or every position for the scalar form
+				mixes = a.isTimeAxis(rankA - 1) || (tensors[op.output].getRank() != rankA - 1 && !a.timeAxes.empty());
+			}
+
+			if (mixes)
+				return &op;
+		}
+
+		return nullptr;
+	}
+
+	void GraphRuntime::reserveCapacity()
+	{
+		if (maxBatchSize_ == batchSize_ && maxSeqLen_ == seqLen_)
+			return;
+
+		// Reserve room for the largest batch and sequence so that growing never reallocates mid-training
+		for (auto &tensor : tensors)
+		{
+			if (!tensor.batched && tensor.timeAxes.empty())
+				continue;
+
+			auto shape = tensor.shape;
+			if (tensor.batched)
+				shape[0] = maxBatchSize_;
+			for (int axis : tensor.timeAxes)
+				shape[static_cast<std::size_t>(axis)] = maxSeqLen_;
+
+			const auto capacity = shapeElementCount(shape);
+			tensor.data.reserve(capacity);
+			tensor.grad.reserve(capacity);
+		}
+	}
 }
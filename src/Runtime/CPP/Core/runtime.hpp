@@ -1,12 +1,18 @@
 #pragma once
 
+#include <algorithm>
 #include <functional>
+#include <iosfwd>
+#include <memory>
 #include <numeric>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include "../ThirdParty/nlohmann/json.hpp"
 #include "../types.hpp"
+#include "json_loader.hpp"
+#include "op_profiler.hpp"
+#include "tensor_storage.hpp"
 
 #ifndef PHP2XAI_USE_EIGEN
 #define PHP2XAI_USE_EIGEN 1
@@ -20,16 +26,24 @@ namespace PHP2xAI::Runtime::CPP
 {
 	using nlohmann::json;
 
+	class WeightsFile;
+	class ModelBundle;
+
 	struct Tensor
 	{
 		int id{};
-		std::vector<Scalar> data;
+		TensorStorage data;
 		std::vector<Scalar> grad;
 		std::vector<int> shape;
 		std::string name;
 		std::string kind;
 		int baseOffset{};
 		std::vector<int> strides;
+		// Leading axis is the (symbolic) batch dimension: resized by GraphRuntime::setBatchSize
+		bool batched = false;
+		// Axes holding the (symbolic) sequence length, ascending: resized by GraphRuntime::setSequenceLength.
+		// Attention scores [B, T, T] carry two
+		std::vector<int> timeAxes;
 
 		static std::vector<int> computeStrides(const std::vector<int> &shape)
 		{
@@ -91,6 +105,14 @@ namespace PHP2xAI::Runtime::CPP
 		{
 			return strides == Tensor::computeStrides(shape) && baseOffset == 0;
 		}
+
+		bool isTimeAxis(int axis) const
+		{
+			if (axis < 0)
+				axis += getRank();
+
+			return std::find(timeAxes.begin(), timeAxes.end(), axis) != timeAxes.end();
+		}
 	};
 
 	struct Op
@@ -119,23 +141,79 @@ namespace PHP2xAI::Runtime::CPP
 		std::vector<Scalar> getOutput() const;
 		void setInput(const std::vector<Scalar> &x);
 		void setTarget(const std::vector<Scalar> &y);
+		// Take ownership of the batch buffer; x receives the previous storage for reuse
+		void swapInput(std::vector<Scalar> &x);
+		void swapTarget(std::vector<Scalar> &y);
+		// Copy into any tensor: a batched tensor given another size switches the batch size like setInput
+		void setTensorData(int id, const Scalar *x, std::size_t n);
+		void setBatchSize(int batchSize);
+		int getBatchSize() const;
+		int getMaxBatchSize() const;
+		std::size_t sampleSize(int id) const;
+		// Sequence graphs ([B, T, D] input): per-batch time length, up to max_sequence_length
+		void setSequenceLength(int steps);
+		int getSequenceLength() const;
+		int getMaxSequenceLength() const;
+		// First op whose result combines positions along a time axis (softmax over T, a matmul contracting T,
+		// a reduction over T), nullptr if none. Reducing the label CE output over T does not count: it is masked
+		const Op *timeMixingOp() const;
 		void resetGrad();
 		void saveWeightsToJson(const std::string &path) const;
+		void saveWeightsToBinary(const std::string &path) const;
+		// Binary format for paths ending in ".bin", JSON otherwise
+		void saveWeights(const std::string &path) const;
+		std::vector<const Tensor *> trainableTensors() const;
+		static bool isBinaryWeightsPath(const std::string &path);
+		static void writeWeights(const std::string &path, const std::vector<const Tensor *> &weights, bool binary);
+		// Into a stream opened by the caller (binary mode), which owns any temp file and rename
+		static void writeWeights(std::ostream &out, const std::vector<const Tensor *> &weights, bool binary);
 		void saveToJson(const std::string &path) const;
 
 		void forward();
 		void backward();
 
+		// Per-op wall time, calls, FLOPs and bytes of forward()/backward(). Off by default: one
+		// predictable branch per op. Contexts have their own switch and counters
+		void setProfiling(bool enabled);
+		bool isProfiling() const;
+		// nullptr until profiling is first enabled
+		const OpProfiler *profile() const;
+		void resetProfile();
+
 		Tensor &getTensor(int id);
 		const Tensor &getTensor(int id) const;
 		
 		void setLossGrad(Scalar lossGrad = 1.0f);
 		
-		explicit GraphRuntime(const json &graphDef, const std::string &weightsPath = "");
+		// shareWeights: params loaded from a binary weights file or a bundle point into its
+		// copy-on-write mapping instead of being copied, so every process mapping the same file
+		// shares one physical copy until it writes to a param
+		explicit GraphRuntime(const json &graphDef, const std::string &weightsPath = "", TensorDataMap graphData = {}, bool shareWeights = false);
+		explicit GraphRuntime(std::shared_ptr<const ModelBundle> bundle, bool shareWeights = false);
+
+		// Forward-only execution context: params are views of this runtime's weights, only the
+		// activations are owned. This runtime must outlive the context and keep its params in place
+		std::unique_ptr<GraphRuntime> createContext() const;
+		bool isContext() const;
 
 	private:
+		GraphRuntime() = default;
+
 		std::string graphPath_;
 		json graphDef_;
+		int batchSize_ = 1;
+		int maxBatchSize_ = 1;
+		int seqLen_ = 0;
+		int maxSeqLen_ = 0;
+		bool forwardOnly_ = false;
+		// Keeps the mapping alive while params are views of it
+		std::shared_ptr<const void> weightsMapping_;
+		bool profiling_ = false;
+		std::unique_ptr<OpProfiler> profiler_;
+
+		void forwardOp(const Op &op);
+		void backwardOp(const Op &op);
+		void recordOp(std::size_t index, bool backward, double seconds);
 
 		void opMatmul(int, int, int, const std::string &kernel);
 		void opAdd(int aId, int bId, int outId, const std::string &kernel);
@@ -205,9 +283,12 @@ namespace PHP2xAI::Runtime::CPP
 		void CE_LOGITS_LABEL_INT_3D_LAST(Tensor &logits, Tensor &target, Tensor &out);
 		void CE_LOGITS_LABEL_INT_GENERIC_AXIS(Tensor &logits, Tensor &target, Tensor &out, int axis);
 		void BACKWORD_CE_LOGITS_LABEL_INT_1D_LAST(Tensor &logits, Tensor &target, Tensor &out);
-		void BACKWORD_CE_LOGITS_LABEL_INT_2D_LAST(Tensor &logits, Tensor &target, Tensor &out);
-		void BACKWORD_CE_LOGITS_LABEL_INT_3D_LAST(Tensor &logits, Tensor &target, Tensor &out);
-		void BACKWORD_CE_LOGITS_LABEL_INT_GENERIC_AXIS(Tensor &logits, Tensor &target, Tensor &out, int axis);
+		void BACKWORD_CE_LOGITS_LABEL_INT_2D_LAST(Tensor &logits, Tensor &target, Tensor &out, Scalar weight);
+		void BACKWORD_CE_LOGITS_LABEL_INT_3D_LAST(Tensor &logits, Tensor &target, Tensor &out, Scalar weight);
+		void BACKWORD_CE_LOGITS_LABEL_INT_GENERIC_AXIS(Tensor &logits, Tensor &target, Tensor &out, int axis, Scalar weight);
+		// Padded positions (label < 0) are out of the loss; the valid ones are weighted by positions / valid
+		// so any mean over the loss (getError, a mean op) averages valid labels only
+		Scalar validLabelWeight(const Tensor &target) const;
 		
 		void MEAN_1D_FIRST(Tensor &A, Tensor &out);
 		void MEAN_2D_FIRST(Tensor &A, Tensor &out);
@@ -219,14 +300,20 @@ namespace PHP2xAI::Runtime::CPP
 		void BACKWARD_MEAN_GENERIC_AXIS(Tensor &A, Tensor &out, int axis);
 
 		void softmaxAlongAxisInPlace(
-			std::vector<Scalar> &data,
+			TensorStorage &data,
 			const std::vector<int> &shape,
 			const std::vector<int> &strides,
 			int axis = -1) const;
 
-		static json loadJson(const std::string &path);
-		void loadTensors(const json &graphDef, const json *weightsDef);
+		void loadTensors(const json &graphDef, TensorDataMap &graphData, JsonLoader::Document *weightsDef, const WeightsFile *weightsBin = nullptr, bool shareWeights = false);
 		void loadOps(const json &graphDef);
+		void markBatchedTensors();
+		bool keepsBatchAxis(const Op &op) const;
+		int reducedAxisOf(const Op &op) const;
+		void markTimedTensors();
+		std::vector<int> timeAxesOf(const Op &op) const;
+		void reserveCapacity();
+		int batchSizeFor(const Tensor &tensor, std::size_t size) const;
 
 		template <class Callback>
 		void forEachSliceAlongAxisIncremental(
@@ -236,12 +323,12 @@ namespace PHP2xAI::Runtime::CPP
 			Callback onSlice) const;
 
 		void addAlongAxisInPlace(
-			std::vector<Scalar> &zData,
+			TensorStorage &zData,
 			const std::vector<int> &zShape,
 			const std::vector<int> &zStrides,
-			const std::vector<Scalar> &xData,
+			const TensorStorage &xData,
 			const std::vector<int> &xStrides,
-			const std::vector<Scalar> &yData,
+			const TensorStorage &yData,
 			const std::vector<int> &yStrides,
 			int axis = -1) const;
 	};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../types.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Tensor::data storage: an owned vector, or a non-owning view of memory that lives elsewhere
+	// (the weights of a shared model, a read-only mapping). Element access goes through one raw
+	// pointer in both cases, so kernels pay nothing for the indirection. Copies are deep and any
+	// size-changing call first turns a view into an owned copy.
+	class TensorStorage
+	{
+	public:
+		using value_type = Scalar;
+		using iterator = Scalar *;
+		using const_iterator = const Scalar *;
+
+		TensorStorage() = default;
+
+		TensorStorage(std::vector<Scalar> values)
+			: owned_(std::move(values))
+		{
+			sync_();
+		}
+
+		TensorStorage(const TensorStorage &other)
+			: owned_(other.begin(), other.end())
+		{
+			sync_();
+		}
+
+		TensorStorage(TensorStorage &&other) noexcept
+		{
+			take_(other);
+		}
+
+		TensorStorage &operator=(const TensorStorage &other)
+		{
+			if (this != &other)
+				assign(other.begin(), other.end());
+			return *this;
+		}
+
+		TensorStorage &operator=(TensorStorage &&other) noexcept
+		{
+			if (this != &other)
+				take_(other);
+			return *this;
+		}
+
+		TensorStorage &operator=(std::vector<Scalar> &&values)
+		{
+			owned_ = std::move(values);
+			sync_();
+			return *this;
+		}
+
+		TensorStorage &operator=(const std::vector<Scalar> &values)
+		{
+			owned_ = values;
+			sync_();
+			return *this;
+		}
+
+		// Point at size values owned by someone else; the memory must outlive this storage
+		void view(const Scalar *data, std::size_t size)
+		{
+			std::vector<Scalar>().swap(owned_);
+			ptr_ = const_cast<Scalar *>(data);
+			size_ = size;
+			external_ = true;
+		}
+
+		bool isView() const { return external_; }
+
+		std::size_t size() const { return size_; }
+		bool empty() const { return size_ == 0; }
+		std::size_t capacity() const { return external_ ? size_ : owned_.capacity(); }
+
+		Scalar *data() { return ptr_; }
+		const Scalar *data() const { return ptr_; }
+
+		Scalar &operator[](std::size_t i) { return ptr_[i]; }
+		const Scalar &operator[](std::size_t i) const { return ptr_[i]; }
+
+		iterator begin() { return ptr_; }
+		iterator end() { return ptr_ + size_; }
+		const_iterator begin() const { return ptr_; }
+		const_iterator end() const { return ptr_ + size_; }
+
+		void resize(std::size_t size, Scalar value = Scalar(0))
+		{
+			detach_();
+			owned_.resize(size, value);
+			sync_();
+		}
+
+		void assign(std::size_t size, Scalar value)
+		{
+			external_ = false;
+			owned_.assign(size, value);
+			sync_();
+		}
+
+		template <typename It>
+		void assign(It first, It last)
+		{
+			// A range inside the owned buffer would be overwritten while copying: copy it aside.
+			// Any other source goes straight into owned_, reusing its capacity (a view's owned_
+			// is empty, so copying out of the viewed memory is safe too)
+			if constexpr (std::is_pointer_v<It>)
+			{
+				if (ownsRange_(first, last))
+				{
+					std::vector<Scalar> values(first, last);
+					owned_.swap(values);
+					sync_();
+					return;
+				}
+			}
+
+			owned_.assign(first, last);
+			sync_();
+		}
+
+		void reserve(std::size_t size)
+		{
+			detach_();
+			owned_.reserve(size);
+			sync_();
+		}
+
+		void clear()
+		{
+			external_ = false;
+			owned_.clear();
+			sync_();
+		}
+
+		void swap(std::vector<Scalar> &values)
+		{
+			detach_();
+			owned_.swap(values);
+			sync_();
+		}
+
+		std::vector<Scalar> toVector() const
+		{
+			return std::vector<Scalar>(begin(), end());
+		}
+
+	private:
+		std::vector<Scalar> owned_;
+		Scalar *ptr_ = nullptr;
+		std::size_t size_ = 0;
+		bool external_ = false;
+
+		void sync_()
+		{
+			ptr_ = owned_.data();
+			size_ = owned_.size();
+			external_ = false;
+		}
+
+		bool ownsRange_(const Scalar *first, const Scalar *last) const
+		{
+			const std::less_equal<const Scalar *> le;
+			const auto *begin = owned_.data();
+			const auto *end = begin + owned_.size();
+
+			return first != last && le(begin, first) && le(last, end);
+		}
+
+		void detach_()
+		{
+			if (external_)
+			{
+				owned_.assign(ptr_, ptr_ + size_);
+				sync_();
+			}
+		}
+
+		void take_(TensorStorage &other)
+		{
+			owned_ = std::move(other.owned_);
+			external_ = other.external_;
+
+			if (external_)
+			{
+				ptr_ = other.ptr_;
+				size_ = other.size_;
+			}
+			else
+			{
+				sync_();
+			}
+
+			other.owned_.clear();
+			other.sync_();
+		}
+	};
+}
@@ -0,0 +1,187 @@
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+#include "trace_recorder.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	namespace
+	{
+		std::atomic<uint64_t> nextRecorderId{1};
+
+		// Last buffer used by this thread: recorder ids are never reused, so a stale entry cannot
+		// point into a destroyed recorder that happens to share an address
+		struct ThreadCache
+		{
+			uint64_t recorder = 0;
+			void *buffer = nullptr;
+		};
+
+		thread_local ThreadCache threadCache;
+
+		void appendMicros(std::string &out, uint64_t nanos)
+		{
+			char text[32];
+			std::snprintf(text, sizeof(text), "%llu.%03llu",
+				static_cast<unsigned long long>(nanos / 1000),
+				static_cast<unsigned long long>(nanos % 1000));
+			out += text;
+		}
+	}
+
+	TraceRecorder::Span::Span(TraceRecorder *trace, const char *name, const char *category)
+		: trace_(trace), name_(name), category_(category)
+	{
+		if (trace_)
+			start_ = trace_->now();
+	}
+
+	TraceRecorder::Span::~Span()
+	{
+		if (trace_)
+			trace_->record(name_, category_, start_, trace_->now());
+	}
+
+	TraceRecorder::TraceRecorder(const std::string &path, std::size_t eventsPerThread)
+		: id_(nextRecorderId.fetch_add(1)),
+		capacity_(eventsPerThread > 0 ? eventsPerThread : 1),
+		origin_(std::chrono::steady_clock::now()),
+		pid_(static_cast<int>(::getpid())),
+		file_(path, std::ios::trunc)
+	{
+		if (!file_.is_open())
+			throw std::runtime_error("Unable to open trace file: " + path);
+
+		// Unterminated until the destructor: viewers accept the array without its "]", so a
+		// crashed run still leaves a readable timeline
+		file_ << "[\n";
+		writeEvent_("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid_)
+			+ ",\"args\":{\"name\":\"php2xai_runtime\"}}");
+	}
+
+	TraceRecorder::~TraceRecorder()
+	{
+		flush();
+		file_ << "\n]\n";
+	}
+
+	uint64_t TraceRecorder::now() const
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - origin_).count());
+	}
+
+	void TraceRecorder::record(const char *name, const char *category, uint64_t start, uint64_t end)
+	{
+		auto &buffer = buffer_();
+
+		const auto head = buffer.head.load(std::memory_order_relaxed);
+		if (head - buffer.tail.load(std::memory_order_acquire) >= capacity_)
+		{
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		buffer.events[head % capacity_] = Event_{name, category, start, end};
+		buffer.head.store(head + 1, std::memory_order_release);
+	}
+
+	void TraceRecorder::nameThread(const std::string &name)
+	{
+		auto &buffer = buffer_();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		buffer.name = name;
+		buffer.nameWritten = false;
+	}
+
+	void TraceRecorder::flush()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::string line;
+
+		for (auto &buffer : buffers_)
+		{
+			if (!buffer->name.empty() && !buffer->nameWritten)
+			{
+				writeEvent_("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid_)
+					+ ",\"tid\":" + std::to_string(buffer->tid) + ",\"args\":{\"name\":\"" + buffer->name + "\"}}");
+				buffer->nameWritten = true;
+			}
+
+			const auto head = buffer->head.load(std::memory_order_acquire);
+			auto tail = buffer->tail.load(std::memory_order_relaxed);
+
+			for (; tail != head; ++tail)
+			{
+				const auto &event = buffer->events[tail % capacity_];
+
+				line.assign("{\"name\":\"");
+				line += event.name;
+				line += "\",\"cat\":\"";
+				line += event.category;
+				line += "\",\"ph\":\"X\",\"ts\":";
+				appendMicros(line, event.start);
+				line += ",\"dur\":";
+				appendMicros(line, event.end - event.start);
+				line += ",\"pid\":" + std::to_string(pid_) + ",\"tid\":" + std::to_string(buffer->tid) + "}";
+
+				writeEvent_(line);
+			}
+
+			buffer->tail.store(head, std::memory_order_release);
+		}
+
+		file_.flush();
+	}
+
+	uint64_t TraceRecorder::dropped() const
+	{
+		return dropped_.load(std::memory_order_relaxed);
+	}
+
+	TraceRecorder::Buffer_ &TraceRecorder::buffer_()
+	{
+		if (threadCache.recorder == id_)
+			return *static_cast<Buffer_ *>(threadCache.buffer);
+
+		return registerThread_();
+	}
+
+	TraceRecorder::Buffer_ &TraceRecorder::registerThread_()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		const auto self = std::this_thread::get_id();
+		Buffer_ *found = nullptr;
+
+		for (auto &buffer : buffers_)
+		{
+			if (buffer->owner == self)
+				found = buffer.get();
+		}
+
+		if (found == nullptr)
+		{
+			auto buffer = std::make_unique<Buffer_>();
+			buffer->owner = self;
+			buffer->tid = static_cast<uint32_t>(buffers_.size() + 1);
+			buffer->events = std::make_unique<Event_[]>(capacity_);
+			found = buffer.get();
+			buffers_.push_back(std::move(buffer));
+		}
+
+		threadCache.recorder = id_;
+		threadCache.buffer = found;
+		return *found;
+	}
+
+	void TraceRecorder::writeEvent_(const std::string &json)
+	{
+		if (!firstEvent_)
+			file_ << ",\n";
+
+		file_ << json;
+		firstEvent_ = false;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Chrome / Perfetto timeline of complete events ("ph": "X"), JSON array format: open the file in
+	// ui.perfetto.dev or chrome://tracing. Every thread records into its own single-producer ring
+	// with no lock on the recording path; flush() drains all rings into the file and may run on any
+	// thread. A thread whose ring is full drops the event (see dropped()) instead of blocking.
+	// Event names and categories are not copied: pass string literals.
+	class TraceRecorder
+	{
+	public:
+		// Records [construction, destruction) of a scope. A null recorder costs one pointer test
+		class Span
+		{
+		public:
+			Span(TraceRecorder *trace, const char *name, const char *category = "train");
+			~Span();
+
+			Span(const Span &) = delete;
+			Span &operator=(const Span &) = delete;
+
+		private:
+			TraceRecorder *trace_;
+			const char *name_;
+			const char *category_;
+			uint64_t start_ = 0;
+		};
+
+		explicit TraceRecorder(const std::string &path, std::size_t eventsPerThread = 1 << 16);
+		// Flushes and closes the JSON array
+		~TraceRecorder();
+
+		TraceRecorder(const TraceRecorder &) = delete;
+		TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+		// Nanoseconds since the recorder was created
+		uint64_t now() const;
+		void record(const char *name, const char *category, uint64_t start, uint64_t end);
+		// Label of the calling thread in the timeline
+		void nameThread(const std::string &name);
+		void flush();
+		uint64_t dropped() const;
+
+	private:
+		struct Event_
+		{
+			const char *name;
+			const char *category;
+			uint64_t start;
+			uint64_t end;
+		};
+
+		struct Buffer_
+		{
+			std::thread::id owner;
+			uint32_t tid = 0;
+			std::string name;
+			bool nameWritten = false;
+			std::unique_ptr<Event_[]> events;
+			// head: written by the owner thread only, tail: by flush() only
+			alignas(64) std::atomic<std::size_t> head{0};
+			alignas(64) std::atomic<std::size_t> tail{0};
+		};
+
+		const uint64_t id_;
+		const std::size_t capacity_;
+		const std::chrono::steady_clock::time_point origin_;
+		const int pid_;
+
+		std::mutex mutex_;
+		std::vector<std::unique_ptr<Buffer_>> buffers_;
+		std::ofstream file_;
+		bool firstEvent_ = true;
+		std::atomic<uint64_t> dropped_{0};
+
+		Buffer_ &buffer_();
+		Buffer_ &registerThread_();
+		void writeEvent_(const std::string &json);
+	};
+}
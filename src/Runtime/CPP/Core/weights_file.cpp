@@ -0,0 +1,240 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "runtime.hpp"
+#include "weights_file.hpp"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	#error "Binary weights are stored little-endian: big-endian hosts are not supported"
+#endif
+
+namespace PHP2xAI::Runtime::CPP
+{
+	namespace
+	{
+		constexpr char Magic[4] = {'P', '2', 'X', 'W'};
+		constexpr uint32_t Version = 1;
+		constexpr uint32_t DTypeFloat32 = 0;
+		constexpr std::size_t MaxRank = 8;
+		constexpr std::size_t Alignment = 64;
+
+		struct FileHeader
+		{
+			char magic[4];
+			uint32_t version;
+			uint32_t count;
+			uint32_t reserved;
+		};
+
+		struct EntryHeader
+		{
+			int32_t id;
+			uint32_t dtype;
+			uint32_t rank;
+			uint32_t reserved;
+			int32_t shape[MaxRank];
+			uint64_t offset;
+			uint64_t count;
+		};
+
+		static_assert(sizeof(FileHeader) == 16, "unexpected weights header size");
+		static_assert(sizeof(EntryHeader) == 64, "unexpected weights entry size");
+
+		std::size_t alignUp(std::size_t value)
+		{
+			return (value + Alignment - 1) / Alignment * Alignment;
+		}
+
+		// Element count of the entry's shape, false on a negative extent or overflow
+		bool shapeCount(const EntryHeader &e, uint64_t &count)
+		{
+			count = 1;
+
+			for (uint32_t a = 0; a < e.rank; ++a)
+			{
+				if (e.shape[a] < 0)
+					return false;
+
+				const auto dim = static_cast<uint64_t>(e.shape[a]);
+				if (dim != 0 && count > UINT64_MAX / dim)
+					return false;
+
+				count *= dim;
+			}
+
+			return true;
+		}
+	}
+
+	WeightsFile::WeightsFile(const std::string &path)
+		: path_(path)
+	{
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Unable to open weights file: " + path);
+
+		struct stat st{};
+		if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(FileHeader))
+		{
+			::close(fd);
+			throw std::runtime_error("Invalid weights file: " + path);
+		}
+
+		mappedBytes_ = static_cast<std::size_t>(st.st_size);
+		// Copy-on-write: pages stay shared with the page cache, and with every other process
+		// mapping this file, until a param viewing them is written
+		mapped_ = ::mmap(nullptr, mappedBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (mapped_ == MAP_FAILED)
+		{
+			mapped_ = nullptr;
+			throw std::runtime_error("Unable to mmap weights file: " + path);
+		}
+
+		const auto *base = static_cast<const unsigned char *>(mapped_);
+		FileHeader header;
+		std::memcpy(&header, base, sizeof(header));
+
+		const auto tableEnd = sizeof(FileHeader) + static_cast<std::size_t>(header.count) * sizeof(EntryHeader);
+
+		if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || tableEnd > mappedBytes_)
+		{
+			::munmap(mapped_, mappedBytes_);
+			mapped_ = nullptr;
+			throw std::runtime_error("Invalid weights file: " + path);
+		}
+
+		entries_.reserve(header.count);
+
+		for (uint32_t i = 0; i < header.count; ++i)
+		{
+			EntryHeader e;
+			std::memcpy(&e, base + sizeof(FileHeader) + i * sizeof(EntryHeader), sizeof(e));
+
+			// The data must lie inside the file (checked without overflowing offset + bytes) and hold
+			// exactly the shape's elements: kernels index params by shape
+			uint64_t elements = 0;
+			if (e.dtype != DTypeFloat32 || e.rank > MaxRank || e.offset % Alignment != 0
+				|| e.offset < tableEnd || e.offset > mappedBytes_
+				|| e.count > (mappedBytes_ - e.offset) / sizeof(Scalar)
+				|| !shapeCount(e, elements) || elements != e.count)
+			{
+				::munmap(mapped_, mappedBytes_);
+				mapped_ = nullptr;
+				throw std::runtime_error("Invalid weights entry in: " + path);
+			}
+
+			Entry entry;
+			entry.id = e.id;
+			entry.shape.assign(e.shape, e.shape + e.rank);
+			entry.data = reinterpret_cast<const Scalar *>(base + e.offset);
+			entry.count = static_cast<std::size_t>(e.count);
+
+			index_[entry.id] = entries_.size();
+			entries_.push_back(std::move(entry));
+		}
+	}
+
+	WeightsFile::~WeightsFile()
+	{
+		if (mapped_ != nullptr)
+			::munmap(mapped_, mappedBytes_);
+	}
+
+	const WeightsFile::Entry *WeightsFile::find(int id) const
+	{
+		const auto it = index_.find(id);
+		return it == index_.end() ? nullptr : &entries_[it->second];
+	}
+
+	const std::vector<WeightsFile::Entry> &WeightsFile::entries() const
+	{
+		return entries_;
+	}
+
+	bool WeightsFile::isBinary(const std::string &path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		char magic[4] = {};
+
+		return file.read(magic, sizeof(magic)) && std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+	}
+
+	void WeightsFile::write(const std::string &path, const std::vector<const Tensor *> &tensors)
+	{
+		const auto tmpPath = path + ".tmp";
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			throw std::runtime_error("Unable to open file for writing: " + tmpPath);
+
+		write(file, tensors);
+		file.close();
+
+		if (!file)
+		{
+			std::remove(tmpPath.c_str());
+			throw std::runtime_error("Unable to write weights file: " + path);
+		}
+
+		if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+		{
+			std::remove(tmpPath.c_str());
+			throw std::runtime_error("Unable to rename weights file: " + tmpPath);
+		}
+	}
+
+	void WeightsFile::write(std::ostream &out, const std::vector<const Tensor *> &tensors)
+	{
+		FileHeader header{};
+		std::memcpy(header.magic, Magic, sizeof(Magic));
+		header.version = Version;
+		header.count = static_cast<uint32_t>(tensors.size());
+
+		std::vector<EntryHeader> table(tensors.size());
+		std::size_t offset = alignUp(sizeof(FileHeader) + tensors.size() * sizeof(EntryHeader));
+
+		for (std::size_t i = 0; i < tensors.size(); ++i)
+		{
+			const auto &t = *tensors[i];
+
+			if (t.shape.size() > MaxRank)
+				throw std::runtime_error("Tensor rank too high for the binary weights format: " + t.name);
+
+			auto &e = table[i];
+			e = EntryHeader{};
+			e.id = t.id;
+			e.dtype = DTypeFloat32;
+			e.rank = static_cast<uint32_t>(t.shape.size());
+			for (std::size_t a = 0; a < t.shape.size(); ++a)
+				e.shape[a] = t.shape[a];
+			e.offset = offset;
+			e.count = t.data.size();
+
+			offset = alignUp(offset + t.data.size() * sizeof(Scalar));
+		}
+
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char *>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(EntryHeader)));
+
+		static const char zeros[Alignment] = {};
+		std::size_t written = sizeof(header) + table.size() * sizeof(EntryHeader);
+
+		for (std::size_t i = 0; i < tensors.size(); ++i)
+		{
+			out.write(zeros, static_cast<std::streamsize>(table[i].offset - written));
+
+			const auto &data = tensors[i]->data;
+			out.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(Scalar)));
+			written = table[i].offset + data.size() * sizeof(Scalar);
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../types.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	struct Tensor;
+
+	// Binary weights file: 16-byte header ("P2XW", version, tensor count), one 64-byte entry
+	// per tensor (id, dtype, rank, shape, offset, element count), then the raw little-endian
+	// float32 data of each tensor aligned to 64 bytes. Opened through a private mmap: pages
+	// are faulted in only when a tensor is actually read, either copied out or used in place.
+	class WeightsFile
+	{
+	public:
+		struct Entry
+		{
+			int id{};
+			std::vector<int> shape;
+			const Scalar *data = nullptr;
+			std::size_t count = 0;
+		};
+
+		explicit WeightsFile(const std::string &path);
+		~WeightsFile();
+
+		WeightsFile(const WeightsFile &) = delete;
+		WeightsFile &operator=(const WeightsFile &) = delete;
+
+		const Entry *find(int id) const;
+		const std::vector<Entry> &entries() const;
+
+		// True when path starts with the binary weights magic
+		static bool isBinary(const std::string &path);
+		// Written aside and renamed over path: processes mapping the old file keep their pages
+		static void write(const std::string &path, const std::vector<const Tensor *> &tensors);
+		// Format only, for callers that handle the file themselves
+		static void write(std::ostream &out, const std::vector<const Tensor *> &tensors);
+
+	private:
+		std::string path_;
+		void *mapped_ = nullptr;
+		std::size_t mappedBytes_ = 0;
+		std::vector<Entry> entries_;
+		std::unordered_map<int, std::size_t> index_;
+	};
+}
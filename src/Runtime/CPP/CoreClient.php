@@ -0,0 +1,196 @@
+<?php
+
+namespace PHP2xAI\Runtime\CPP;
+
+use RuntimeException;
+
+/**
+ * Client of the local inference daemon (php2xai_runtime --serve server.json): same predict API as
+ * CoreFFI, but the model lives in the daemon, which batches the samples of concurrent workers
+ */
+class CoreClient
+{
+	private const OP_INFO = 0;
+	private const OP_PREDICT = 1;
+	private const OP_PREDICT_LABEL_INT = 2;
+	private const OP_PREDICT_TOPK = 3;
+
+	/** @var resource */
+	private $socket;
+	private string $model;
+	private int $sampleInputSize;
+	private int $sampleOutputSize;
+
+	/**
+	 * Persistent connections survive the request: a PHP-FPM worker connects once
+	 */
+	public function __construct(string $socketPath, string $model, float $timeout = 5.0, bool $persistent = true)
+	{
+		$flags = STREAM_CLIENT_CONNECT | ($persistent ? STREAM_CLIENT_PERSISTENT : 0);
+		$socket = @stream_socket_client("unix://".$socketPath, $errno, $error, $timeout, $flags);
+
+		if ($socket === false)
+			throw new RuntimeException("Unable to connect to inference server: ".$error);
+
+		stream_set_timeout($socket, (int)$timeout, (int)(($timeout - (int)$timeout) * 1000000));
+
+		$this->socket = $socket;
+		$this->model = $model;
+
+		$info = unpack('V3', $this->request(self::OP_INFO, 0, 0, ''));
+		$this->sampleInputSize = $info[1];
+		$this->sampleOutputSize = $info[2];
+	}
+
+	public function predict(array $x) : array
+	{
+		return $this->predictBatch([$x])[0];
+	}
+
+	public function predictBatch(array $samples) : array
+	{
+		$n = count($samples);
+
+		if ($n === 0)
+			return [];
+
+		$payload = $this->request(self::OP_PREDICT, $n, 0, $this->packSamples($samples));
+
+		return array_chunk(array_values(unpack('g*', $payload)), $this->sampleOutputSize);
+	}
+
+	public function predictLabelInt(array $x) : int
+	{
+		return $this->predictLabelIntBatch([$x])[0];
+	}
+
+	public function predictLabelIntBatch(array $samples) : array
+	{
+		$n = count($samples);
+
+		if ($n === 0)
+			return [];
+
+		return array_values(unpack('l*', $this->request(self::OP_PREDICT_LABEL_INT, $n, 0, $this->packSamples($samples))));
+	}
+
+	/**
+	 * k best classes of one sample, best first: [[id, probability], ...]
+	 */
+	public function predictTopK(array $x, int $k) : array
+	{
+		return $this->predictTopKBatch([$x], $k)[0];
+	}
+
+	public function predictTopKBatch(array $samples, int $k) : array
+	{
+		$n = count($samples);
+
+		if ($n === 0)
+			return [];
+
+		$payload = $this->request(self::OP_PREDICT_TOPK, $n, $k, $this->packSamples($samples));
+		$ids = array_values(unpack('l*', substr($payload, 0, $n * $k * 4)));
+		$scores = array_values(unpack('g*', substr($payload, $n * $k * 4)));
+
+		$result = [];
+
+		for ($i = 0; $i < $n; $i++)
+		{
+			$row = [];
+
+			for ($j = $i * $k; $j < ($i + 1) * $k && $ids[$j] >= 0; $j++)
+				$row[] = [$ids[$j], $scores[$j]];
+
+			$result[] = $row;
+		}
+
+		return $result;
+	}
+
+	public function getSampleInputSize() : int
+	{
+		return $this->sampleInputSize;
+	}
+
+	public function getSampleOutputSize() : int
+	{
+		return $this->sampleOutputSize;
+	}
+
+	private function packSamples(array $samples) : string
+	{
+		$flat = [];
+
+		foreach ($samples as $sample)
+		{
+			if (count($sample) !== $this->sampleInputSize)
+				throw new RuntimeException("Inserting incompatible dimensions");
+
+			foreach ($sample as $v)
+				$flat[] = (float)$v;
+		}
+
+		return pack('g*', ...$flat);
+	}
+
+	private function request(int $op, int $n, int $k, string $body) : string
+	{
+		$message = "P2XQ".pack('V4', $op, strlen($this->model), $n, $k).$this->model.$body;
+
+		if (!$this->writeAll($message))
+			$this->fail("Unable to send request to inference server");
+
+		$header = $this->readExactly(12);
+
+		if (substr($header, 0, 4) !== "P2XR")
+			$this->fail("Invalid response from inference server");
+
+		$fields = unpack('lstatus/Vbytes', substr($header, 4));
+		$payload = $fields['bytes'] > 0 ? $this->readExactly($fields['bytes']) : '';
+
+		if ($fields['status'] !== 0)
+			throw new RuntimeException("Inference server error ".$fields['status'].": ".$payload);
+
+		return $payload;
+	}
+
+	private function writeAll(string $data) : bool
+	{
+		for ($written = 0; $written < strlen($data); $written += $n)
+		{
+			$n = fwrite($this->socket, substr($data, $written));
+
+			if ($n === false || $n === 0)
+				return false;
+		}
+
+		return true;
+	}
+
+	private function readExactly(int $bytes) : string
+	{
+		$data = '';
+
+		while (strlen($data) < $bytes)
+		{
+			$chunk = fread($this->socket, $bytes - strlen($data));
+
+			if ($chunk === false || $chunk === '')
+				$this->fail("Inference server closed the connection");
+
+			$data .= $chunk;
+		}
+
+		return $data;
+	}
+
+	/**
+	 * A half-read response would desynchronize the persistent stream: drop it
+	 */
+	private function fail(string $message) : void
+	{
+		fclose($this->socket);
+		throw new RuntimeException($message);
+	}
+}
@@ -11,8 +11,10 @@ class CoreFFI
 	private $handle;
 	private int $inputSize;
 	private int $outputSize;
+	private int $sampleInputSize;
+	private int $sampleOutputSize;
 
-	public function __construct(string $modelPath, string $weightsPath, string $soPath)
+	public function __construct(string $modelPath, string $weightsPath, string $soPath, bool $isBundle = false)
 	{
 		if (!extension_loaded('ffi'))
 			throw new RuntimeException("FFI extension is not enabled");
@@ -21,7 +23,11 @@ class CoreFFI
 			throw new RuntimeException("FFI library not found: ".$soPath);
 		
 		$this->ffi = FFI::cdef($this->getCdef(), $soPath);
-		$this->handle = $this->ffi->php2xai_core_create($modelPath, $weightsPath);
+		
+		if ($isBundle)
+			$this->handle = $this->ffi->php2xai_core_create_from_bundle($modelPath);
+		else
+			$this->handle = $this->ffi->php2xai_core_create($modelPath, $weightsPath);
 		
 		if ($this->handle === null)
 			throw new RuntimeException("Unable to initialize CPP runtime");
@@ -31,6 +37,9 @@ class CoreFFI
 		
 		if ($this->inputSize <= 0 || $this->outputSize <= 0)
 			throw new RuntimeException("Invalid CPP runtime sizes");
+		
+		$this->sampleInputSize = (int)$this->ffi->php2xai_core_sample_input_size($this->handle);
+		$this->sampleOutputSize = (int)$this->ffi->php2xai_core_sample_output_size($this->handle);
 	}
 	
 	public function __destruct()
@@ -42,6 +51,22 @@ class CoreFFI
 		}
 	}
 	
+	/**
+	 * Single-file model (graph, op plan and weights) written by saveBundle()
+	 */
+	public static function fromBundle(string $bundlePath, string $soPath) : self
+	{
+		return new self($bundlePath, '', $soPath, true);
+	}
+	
+	public function saveBundle(string $bundlePath) : void
+	{
+		$rc = $this->ffi->php2xai_core_save_bundle($this->handle, $bundlePath);
+		
+		if ($rc !== 0)
+			throw new RuntimeException("CPP saveBundle failed: ".$rc);
+	}
+	
 	public function predict(array $x) : array
 	{
 		$values = array_values($x);
@@ -102,17 +127,179 @@ class CoreFFI
 		return (int)$outLabel[0];
 	}
 	
+	/**
+	 * Many samples in one call: $samples is a list of sampleInputSize() vectors,
+	 * returns one output row per sample
+	 */
+	public function predictBatch(array $samples) : array
+	{
+		$n = count($samples);
+		
+		if ($n === 0)
+			return [];
+		
+		$input = $this->packSamples($samples);
+		$output = FFI::new("float[".($n * $this->sampleOutputSize)."]");
+		
+		$rc = $this->ffi->php2xai_core_predict_batch($this->handle, $input, $n, $output);
+		
+		if ($rc !== 0)
+			throw new RuntimeException("CPP predictBatch failed: ".$rc);
+		
+		$values = array_values(unpack('g*', FFI::string($output, $n * $this->sampleOutputSize * 4)));
+		
+		return array_chunk($values, $this->sampleOutputSize);
+	}
+	
+	public function predictLabelIntBatch(array $samples) : array
+	{
+		$n = count($samples);
+		
+		if ($n === 0)
+			return [];
+		
+		$input = $this->packSamples($samples);
+		$labels = FFI::new("int[".$n."]");
+		
+		$rc = $this->ffi->php2xai_core_predict_label_int_batch($this->handle, $input, $n, $labels);
+		
+		if ($rc !== 0)
+			throw new RuntimeException("CPP predictLabelIntBatch failed: ".$rc);
+		
+		return array_values(unpack('l*', FFI::string($labels, $n * 4)));
+	}
+	
+	/**
+	 * k best classes of one sample, best first: [[id, probability], ...]
+	 */
+	public function predictTopK(array $x, int $k) : array
+	{
+		return $this->predictTopKBatch([$x], $k)[0];
+	}
+	
+	public function predictTopKBatch(array $samples, int $k) : array
+	{
+		$n = count($samples);
+		
+		if ($n === 0 || $k <= 0)
+			return array_fill(0, $n, []);
+		
+		$input = $this->packSamples($samples);
+		$ids = FFI::new("int[".($n * $k)."]");
+		$scores = FFI::new("float[".($n * $k)."]");
+		
+		$rc = $this->ffi->php2xai_core_predict_topk_batch($this->handle, $input, $n, $k, $ids, $scores);
+		
+		if ($rc !== 0)
+			throw new RuntimeException("CPP predictTopKBatch failed: ".$rc);
+		
+		$result = [];
+		
+		for ($i = 0; $i < $n; $i++)
+		{
+			$row = [];
+			
+			for ($j = $i * $k; $j < ($i + 1) * $k && $ids[$j] >= 0; $j++)
+				$row[] = [(int)$ids[$j], (float)$scores[$j]];
+			
+			$result[] = $row;
+		}
+		
+		return $result;
+	}
+	
+	/**
+	 * Autoregressive decoding entirely in the runtime: returns the new token ids.
+	 * topK 0 samples from the whole vocabulary, temperature 0 is greedy, seed 0 is random
+	 */
+	public function generate(array $prompt, int $maxNewTokens, int $topK = 0, float $temperature = 0.0, int $seed = 0, int $stopToken = -1) : array
+	{
+		$n = count($prompt);
+		
+		if ($n === 0)
+			throw new RuntimeException("Empty prompt");
+		
+		$input = FFI::new("int[".$n."]");
+		FFI::memcpy($input, pack('l*', ...array_map('intval', $prompt)), $n * 4);
+		
+		$tokens = FFI::new("int[".max($maxNewTokens, 1)."]");
+		$len = $this->ffi->new("size_t[1]");
+		
+		$rc = $this->ffi->php2xai_core_generate(
+			$this->handle,
+			$input,
+			$n,
+			max($maxNewTokens, 0),
+			max($topK, 0),
+			$temperature,
+			$seed,
+			$stopToken,
+			$tokens,
+			$len
+		);
+		
+		if ($rc !== 0)
+			throw new RuntimeException("CPP generate failed: ".$rc);
+		
+		$result = [];
+		
+		for ($i = 0; $i < $len[0]; $i++)
+			$result[] = (int)$tokens[$i];
+		
+		return $result;
+	}
+	
+	public function getSampleInputSize() : int
+	{
+		return $this->sampleInputSize;
+	}
+	
+	public function getSampleOutputSize() : int
+	{
+		return $this->sampleOutputSize;
+	}
+	
+	private function packSamples(array $samples)
+	{
+		$n = count($samples);
+		$flat = [];
+		
+		foreach ($samples as $sample)
+		{
+			if (count($sample) !== $this->sampleInputSize)
+				throw new RuntimeException("Inserting incompatible dimensions");
+			
+			foreach ($sample as $v)
+				$flat[] = (float)$v;
+		}
+		
+		// pack('g*') yields little-endian floats: one copy into FFI memory
+		$buffer = FFI::new("float[".($n * $this->sampleInputSize)."]");
+		FFI::memcpy($buffer, pack('g*', ...$flat), $n * $this->sampleInputSize * 4);
+		
+		return $buffer;
+	}
+	
 	private function getCdef() : string
 	{
 		return <<<CDEF
 			typedef unsigned long size_t;
 			typedef struct PHP2xAI_Core PHP2xAI_Core;
 			PHP2xAI_Core* php2xai_core_create(const char* model_path, const char* weights_path);
+			PHP2xAI_Core* php2xai_core_create_from_bundle(const char* bundle_path);
+			int php2xai_core_save_bundle(PHP2xAI_Core* core, const char* bundle_path);
 			void php2xai_core_destroy(PHP2xAI_Core* core);
 			size_t php2xai_core_input_size(PHP2xAI_Core* core);
 			size_t php2xai_core_output_size(PHP2xAI_Core* core);
 			int php2xai_core_predict(PHP2xAI_Core* core, const float* x, size_t x_len, float* out, size_t out_len);
 			int php2xai_core_predict_label_int(PHP2xAI_Core* core, const float* x, size_t x_len, int* out_label);
+			size_t php2xai_core_sample_input_size(PHP2xAI_Core* core);
+			size_t php2xai_core_sample_output_size(PHP2xAI_Core* core);
+			int php2xai_core_predict_batch(PHP2xAI_Core* core, const float* x, size_t n, float* out);
+			int php2xai_core_predict_label_int_batch(PHP2xAI_Core* core, const float* x, size_t n, int* out_labels);
+			int php2xai_core_predict_topk(PHP2xAI_Core* core, const float* x, size_t k, int* out_ids, float* out_scores);
+			int php2xai_core_predict_topk_batch(PHP2xAI_Core* core, const float* x, size_t n, size_t k, int* out_ids, float* out_scores);
+			int php2xai_core_generate(PHP2xAI_Core* core, const int* prompt, size_t prompt_len, size_t max_new_tokens, size_t top_k, float temperature, uint64_t seed, int stop_token, int* out_tokens, size_t* out_len);
 		CDEF;
 	}
 }
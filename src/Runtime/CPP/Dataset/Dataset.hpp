@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace PHP2xAI::Runtime::CPP
+{
+	class StateWriter;
+	class StateReader;
+
+	class Dataset
+	{
+	public:
+		virtual ~Dataset() = default;
+
+		virtual std::size_t numBatches() const = 0;
+
+		virtual void shuffleEpoch() = 0;
+		virtual void resetEpoch() = 0;
+
+		// Equivalente del foreach($dataset as $batch)
+		virtual bool nextBatch() = 0;
+
+		// Pack del batch corrente in row-major: ritorna xPacked e yPacked
+		virtual void pack(std::vector<float>& xPacked, std::vector<float>& yPacked) = 0;
+
+		// Asse temporale dell'ultimo batch impacchettato (0 = fisso, quello del grafo)
+		virtual int sequenceLength() const { return 0; }
+
+		// Sorgente esaurita per sempre (es. producer che ha chiuso il ring): nessuna epoca successiva
+		virtual bool closed() const { return false; }
+
+		// Stato per riprendere l'addestramento (RNG, ordine dell'epoca, posizione): dopo
+		// loadState() i batch successivi sono identici a quelli dell'esecuzione salvata
+		virtual bool hasState() const { return false; }
+
+		virtual void saveState(StateWriter& /*out*/) const
+		{
+			throw std::runtime_error("Dataset does not support resumable training state");
+		}
+
+		virtual void loadState(StateReader& /*in*/)
+		{
+			throw std::runtime_error("Dataset does not support resumable training state");
+		}
+
+	protected:
+		static bool isBlank_(const std::string& s)
+		{
+			for (unsigned char c : s) if (!std::isspace(c)) return false;
+			return true;
+		}
+
+		// Accoda a out i float di sv. sv punta dentro una riga: termina sul
+		// delimitatore o sul terminatore della stringa
+		static void parseFloatVector_(std::string_view sv, std::vector<float>& out)
+		{
+			const char* cur = sv.data();
+			const char* end = sv.data() + sv.size();
+
+			while (cur < end)
+			{
+				char* next = nullptr;
+				const float v = std::strtof(cur, &next);
+				if (next == cur || next > end) break;
+
+				out.push_back(v);
+				cur = next;
+			}
+		}
+	};
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "Dataset.hpp"
+#include "bucket_file_dataset.hpp"
+#include "shm_ring_dataset.hpp"
+#include "stream_file_dataset.hpp"
+#include "token_stream_dataset.hpp"
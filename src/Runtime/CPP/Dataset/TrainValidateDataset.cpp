@@ -2,7 +2,7 @@
 
 namespace PHP2xAI::Runtime::CPP
 {
-	TrainValidateDataset::TrainValidateDataset(StreamFileDataset& trainDataset, StreamFileDataset& valDataset)
+	TrainValidateDataset::TrainValidateDataset(Dataset& trainDataset, Dataset& valDataset)
 		: train(trainDataset), val(valDataset)
 	{
 	}
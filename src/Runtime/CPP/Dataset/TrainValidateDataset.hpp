@@ -1,15 +1,15 @@
 #pragma once
 
-#include "stream_file_dataset.hpp"
+#include "Dataset.hpp"
 
 namespace PHP2xAI::Runtime::CPP
 {
 	class TrainValidateDataset
 	{
 	public:
-		TrainValidateDataset(StreamFileDataset& trainDataset, StreamFileDataset& valDataset);
+		TrainValidateDataset(Dataset& trainDataset, Dataset& valDataset);
 
-		StreamFileDataset& train;
-		StreamFileDataset& val;
+		Dataset& train;
+		Dataset& val;
 	};
 }
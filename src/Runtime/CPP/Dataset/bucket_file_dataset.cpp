@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bucket_file_dataset.hpp"
+#include "../Utility/state_stream.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	namespace
+	{
+		// Label delle posizioni di padding: i kernel CE_LOGITS_LABEL_INT le ignorano
+		constexpr float PadLabel = -1.0f;
+	}
+
+	BucketFileDataset::BucketFileDataset(std::vector<std::string> paths,
+										std::size_t batchSize,
+										std::size_t poolBatches,
+										char delimiter,
+										uint32_t seed)
+		: paths_(std::move(paths)),
+		batchSize_(batchSize),
+		poolBatches_(std::max<std::size_t>(poolBatches, 1)),
+		delimiter_(delimiter),
+		rng_(seed)
+	{
+		if (batchSize_ == 0)
+			throw std::runtime_error("batchSize must be > 0");
+
+		if (paths_.empty())
+			throw std::runtime_error("Dataset has no files");
+
+		for (const auto& p : paths_)
+		{
+			files_.emplace_back(p);
+			if (!files_.back().is_open())
+				throw std::runtime_error("Unable to open dataset file: " + p);
+		}
+
+		buildIndex_();
+
+		// Ordine iniziale (validazione): tutti i sample ordinati per lunghezza, padding minimo
+		std::vector<std::size_t> ids(samples_.size());
+		std::iota(ids.begin(), ids.end(), 0);
+		sortedBatches_(ids, ids.size());
+		resetEpoch();
+	}
+
+	std::size_t BucketFileDataset::numBatches() const { return batches_.size(); }
+
+	std::size_t BucketFileDataset::numSamples() const { return samples_.size(); }
+
+	std::size_t BucketFileDataset::featureDim() const { return featureDim_; }
+
+	std::size_t BucketFileDataset::maxLength() const { return maxLength_; }
+
+	double BucketFileDataset::paddingRatio() const
+	{
+		return totalSteps_ == 0 ? 0.0 : static_cast<double>(paddedSteps_) / static_cast<double>(totalSteps_);
+	}
+
+	int BucketFileDataset::sequenceLength() const { return seqLen_; }
+
+	void BucketFileDataset::shuffleEpoch()
+	{
+		// Shuffle globale, poi ordinamento per lunghezza dentro ogni pool di poolBatches batch
+		// e shuffle dei batch: i batch restano omogenei ma l'ordine cambia a ogni epoca
+		std::vector<std::size_t> ids(samples_.size());
+		std::iota(ids.begin(), ids.end(), 0);
+		std::shuffle(ids.begin(), ids.end(), rng_);
+
+		sortedBatches_(ids, batchSize_ * poolBatches_);
+		std::shuffle(batches_.begin(), batches_.end(), rng_);
+		resetEpoch();
+	}
+
+	void BucketFileDataset::resetEpoch()
+	{
+		curBatchPos_ = 0;
+	}
+
+	bool BucketFileDataset::nextBatch()
+	{
+		return curBatchPos_ < batches_.size();
+	}
+
+	void BucketFileDataset::pack(std::vector<float>& xPacked, std::vector<float>& yPacked)
+	{
+		const auto& batch = batches_.at(curBatchPos_);
+
+		std::size_t steps = 0;
+		for (auto id : batch)
+			steps = std::max<std::size_t>(steps, samples_[id].length);
+
+		const auto rows = batch.size();
+		xPacked.assign(rows * steps * featureDim_, 0.0f);
+		yPacked.assign(rows * steps, PadLabel);
+
+		for (std::size_t r = 0; r < rows; ++r)
+		{
+			const auto& sample = samples_[batch[r]];
+			auto& file = files_[sample.file];
+
+			file.clear();
+			file.seekg(sample.offset);
+			if (!file || !std::getline(file, line_))
+				throw std::runtime_error("Unable to read sample from: " + paths_[sample.file]);
+
+			const auto p = line_.find(delimiter_);
+			if (p == std::string::npos)
+				throw std::runtime_error("Invalid line (missing delimiter): " + line_);
+
+			rowX_.clear();
+			rowY_.clear();
+			parseFloatVector_(std::string_view(line_.data(), p), rowX_);
+			parseFloatVector_(std::string_view(line_.data() + p + 1, line_.size() - p - 1), rowY_);
+
+			if (rowY_.size() != sample.length || rowX_.size() != sample.length * featureDim_)
+				throw std::runtime_error("Invalid line (inconsistent x/y length): " + line_);
+
+			// Il padding resta in coda: la riga r occupa le prime length posizioni
+			std::copy(rowX_.begin(), rowX_.end(), xPacked.begin() + static_cast<std::ptrdiff_t>(r * steps * featureDim_));
+			std::copy(rowY_.begin(), rowY_.end(), yPacked.begin() + static_cast<std::ptrdiff_t>(r * steps));
+
+			paddedSteps_ += steps - sample.length;
+		}
+
+		totalSteps_ += rows * steps;
+		seqLen_ = static_cast<int>(steps);
+		++curBatchPos_;
+	}
+
+	bool BucketFileDataset::hasState() const { return true; }
+
+	void BucketFileDataset::saveState(StateWriter& out) const
+	{
+		out.rng(rng_);
+		out.u64(batches_.size());
+		for (const auto& batch : batches_)
+			out.vector(batch);
+		out.u64(curBatchPos_);
+	}
+
+	void BucketFileDataset::loadState(StateReader& in)
+	{
+		in.rng(rng_);
+
+		std::vector<std::vector<std::size_t>> batches(static_cast<std::size_t>(in.u64()));
+		for (auto& batch : batches)
+		{
+			batch = in.vector<std::size_t>();
+
+			for (auto id : batch)
+				if (id >= samples_.size())
+					throw std::runtime_error("Training state does not match the dataset files");
+		}
+
+		const auto pos = static_cast<std::size_t>(in.u64());
+		if (pos > batches.size())
+			throw std::runtime_error("Training state batch position out of range");
+
+		batches_ = std::move(batches);
+		curBatchPos_ = pos;
+	}
+
+	void BucketFileDataset::buildIndex_()
+	{
+		for (uint32_t f = 0; f < files_.size(); ++f)
+			indexFile_(f);
+
+		if (samples_.empty())
+			throw std::runtime_error("Dataset is empty: " + paths_.front());
+	}
+
+	void BucketFileDataset::indexFile_(uint32_t file)
+	{
+		// Una sola passata: offset e lunghezza di ogni riga, contando i valori senza parsarli
+		auto& in = files_[file];
+		in.clear();
+		in.seekg(0);
+
+		while (true)
+		{
+			const std::streampos pos = in.tellg();
+			if (!std::getline(in, line_)) break;
+
+			if (isBlank_(line_))
+				continue;
+
+			const auto p = line_.find(delimiter_);
+			if (p == std::string::npos)
+				throw std::runtime_error("Invalid line (missing delimiter): " + line_);
+
+			const auto xCount = countValues_(line_.data(), line_.data() + p);
+			const auto yCount = countValues_(line_.data() + p + 1, line_.data() + line_.size());
+
+			if (xCount == 0 || yCount == 0 || xCount % yCount != 0)
+				throw std::runtime_error("Invalid line (x is not T * D values): " + line_);
+
+			if (featureDim_ == 0)
+				featureDim_ = xCount / yCount;
+			else if (xCount != yCount * featureDim_)
+				throw std::runtime_error("Invalid line (feature size differs from "
+					+ std::to_string(featureDim_) + "): " + line_);
+
+			Sample_ sample;
+			sample.offset = pos;
+			sample.file = file;
+			sample.length = static_cast<uint32_t>(yCount);
+			samples_.push_back(sample);
+
+			maxLength_ = std::max<std::size_t>(maxLength_, yCount);
+		}
+
+		in.clear();
+		in.seekg(0);
+	}
+
+	void BucketFileDataset::sortedBatches_(std::vector<std::size_t>& ids, std::size_t poolSize)
+	{
+		batches_.clear();
+
+		for (std::size_t begin = 0; begin < ids.size(); begin += poolSize)
+		{
+			const auto end = std::min(ids.size(), begin + poolSize);
+			std::stable_sort(ids.begin() + static_cast<std::ptrdiff_t>(begin),
+							ids.begin() + static_cast<std::ptrdiff_t>(end),
+							[this](std::size_t a, std::size_t b) { return samples_[a].length < samples_[b].length; });
+
+			for (std::size_t first = begin; first < end; first += batchSize_)
+			{
+				const auto last = std::min(end, first + batchSize_);
+				batches_.emplace_back(ids.begin() + static_cast<std::ptrdiff_t>(first),
+									ids.begin() + static_cast<std::ptrdiff_t>(last));
+			}
+		}
+	}
+
+	std::size_t BucketFileDataset::countValues_(const char* begin, const char* end)
+	{
+		std::size_t count = 0;
+		bool inValue = false;
+
+		for (const char* c = begin; c < end; ++c)
+		{
+			const bool space = std::isspace(static_cast<unsigned char>(*c)) != 0;
+			if (!space && !inValue)
+				++count;
+			inValue = !space;
+		}
+
+		return count;
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Dataset.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Dataset di sequenze a lunghezza variabile: ogni riga è "x (T*D valori) | y (T label)".
+	// I batch raggruppano sample di lunghezza simile (bucketing) e vengono allineati alla
+	// sequenza più lunga del batch: x = [rows, T, D] con padding a 0, y = [rows, T] con
+	// label -1 sulle posizioni di padding (maschera dei kernel CE_LOGITS_LABEL_INT).
+	// La maschera vale solo per la loss: Core rifiuta il bucketing se un op mescola i passi
+	// sull'asse T (softmax su T, matmul che contrae T, media su T), che vedrebbero il padding
+	class BucketFileDataset final : public Dataset
+	{
+	public:
+		// poolBatches: quanti batch consecutivi (dopo lo shuffle) vengono ordinati per
+		// lunghezza insieme. Più grande = meno padding, meno casualità tra i batch
+		explicit BucketFileDataset(std::vector<std::string> paths,
+								std::size_t batchSize,
+								std::size_t poolBatches = 50,
+								char delimiter = '|',
+								uint32_t seed = 42);
+
+		std::size_t numBatches() const override;
+		std::size_t numSamples() const;
+		std::size_t featureDim() const;
+		std::size_t maxLength() const;
+
+		// Frazione di posizioni di padding sui batch impacchettati finora
+		double paddingRatio() const;
+
+		void shuffleEpoch() override;
+		void resetEpoch() override;
+
+		bool nextBatch() override;
+
+		void pack(std::vector<float>& xPacked, std::vector<float>& yPacked) override;
+
+		int sequenceLength() const override;
+
+		bool hasState() const override;
+		void saveState(StateWriter& out) const override;
+		void loadState(StateReader& in) override;
+
+	private:
+		struct Sample_
+		{
+			std::streampos offset;
+			uint32_t file = 0;
+			uint32_t length = 0;                   // T del sample (numero di label)
+		};
+
+		std::vector<std::string> paths_;
+		std::size_t batchSize_;
+		std::size_t poolBatches_;
+		char delimiter_;
+
+		std::mt19937 rng_;
+
+		std::vector<std::ifstream> files_;
+		std::vector<Sample_> samples_;
+		std::vector<std::vector<std::size_t>> batches_;  // sample di ogni batch dell'epoca
+		std::size_t curBatchPos_ = 0;
+		std::size_t featureDim_ = 0;
+		std::size_t maxLength_ = 0;
+		int seqLen_ = 0;                               // T dell'ultimo batch impacchettato
+
+		std::size_t paddedSteps_ = 0;
+		std::size_t totalSteps_ = 0;
+
+		std::string line_;
+		std::vector<float> rowX_;
+		std::vector<float> rowY_;
+
+		void buildIndex_();
+		void indexFile_(uint32_t file);
+		void sortedBatches_(std::vector<std::size_t>& ids, std::size_t poolSize);
+		static std::size_t countValues_(const char* begin, const char* end);
+	};
+}
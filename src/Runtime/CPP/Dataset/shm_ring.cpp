@@ -0,0 +1,289 @@
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "shm_ring.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	namespace
+	{
+		constexpr uint32_t RingMagic = 0x52583250;   // "P2XR"
+		constexpr uint32_t RingVersion = 1;
+
+		constexpr uint32_t KindBatch = 1;
+		constexpr uint32_t KindEndEpoch = 2;
+
+		std::string shmName(const std::string& name)
+		{
+			return !name.empty() && name[0] == '/' ? name : "/" + name;
+		}
+
+		// Attesa attiva breve, poi sleep: il consumer non brucia un core se il producer è lento
+		void backoff(unsigned& spins)
+		{
+			if (++spins < 128)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+
+	struct ShmRing::Header_
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t slots;
+		uint64_t slotFloats;
+		uint64_t slotBytes;
+
+		// Producer e consumer su cache line diverse
+		alignas(64) std::atomic<uint64_t> head;     // prossimo slot da scrivere
+		alignas(64) std::atomic<uint64_t> tail;     // prossimo slot da leggere
+		alignas(64) std::atomic<uint32_t> closed;
+	};
+
+	struct ShmRing::Slot_
+	{
+		uint32_t kind;
+		uint32_t reserved;
+		uint64_t xCount;
+		uint64_t yCount;
+		uint64_t padding;                          // i float partono allineati a 32 byte
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring needs lock-free 64-bit atomics");
+
+	ShmRing::ShmRing(const std::string& name, std::size_t slots, std::size_t slotFloats)
+		: name_(shmName(name)),
+		owner_(true)
+	{
+		if (slots == 0 || slotFloats == 0)
+			throw std::runtime_error("Shared ring needs slots > 0 and slotFloats > 0");
+
+		slots_ = slots;
+		slotFloats_ = slotFloats;
+		slotBytes_ = (sizeof(Slot_) + slotFloats * sizeof(float) + 63) / 64 * 64;
+		const auto bytes = sizeof(Header_) + slots * slotBytes_;
+
+		const int fd = ::shm_open(name_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+		if (fd < 0)
+			throw std::runtime_error("Unable to create shared ring: " + name_);
+
+		if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+		{
+			::close(fd);
+			::shm_unlink(name_.c_str());
+			throw std::runtime_error("Unable to size shared ring: " + name_);
+		}
+
+		map_(fd, bytes);
+
+		header_ = new (mapped_) Header_();
+		header_->version = RingVersion;
+		header_->slots = slots;
+		header_->slotFloats = slotFloats;
+		header_->slotBytes = slotBytes_;
+		header_->head.store(0, std::memory_order_relaxed);
+		header_->tail.store(0, std::memory_order_relaxed);
+		header_->closed.store(0, std::memory_order_relaxed);
+
+		// Il magic per ultimo: chi apre il ring vede un header completo
+		std::atomic_thread_fence(std::memory_order_release);
+		header_->magic = RingMagic;
+	}
+
+	ShmRing::ShmRing(const std::string& name)
+		: name_(shmName(name))
+	{
+		const int fd = ::shm_open(name_.c_str(), O_RDWR, 0600);
+		if (fd < 0)
+			throw std::runtime_error("Unable to open shared ring: " + name_);
+
+		struct stat st{};
+		if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header_))
+		{
+			::close(fd);
+			throw std::runtime_error("Invalid shared ring: " + name_);
+		}
+
+		map_(fd, static_cast<std::size_t>(st.st_size));
+
+		header_ = static_cast<Header_*>(mapped_);
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// Geometria letta una volta sola e verificata sul mapping: il producer non può più spostarla
+		const uint64_t slots = header_->slots;
+		const uint64_t slotFloats = header_->slotFloats;
+		const uint64_t slotBytes = header_->slotBytes;
+
+		if (header_->magic != RingMagic || header_->version != RingVersion
+			|| slots == 0 || slotBytes < sizeof(Slot_)
+			|| slotFloats > (slotBytes - sizeof(Slot_)) / sizeof(float)
+			|| slots > (mappedBytes_ - sizeof(Header_)) / slotBytes)
+		{
+			::munmap(mapped_, mappedBytes_);
+			throw std::runtime_error("Invalid shared ring: " + name_);
+		}
+
+		slots_ = slots;
+		slotFloats_ = slotFloats;
+		slotBytes_ = slotBytes;
+	}
+
+	ShmRing::~ShmRing()
+	{
+		if (mapped_ != nullptr)
+			::munmap(mapped_, mappedBytes_);
+
+		// Il nome sparisce subito, il consumer continua a leggere dal suo mapping
+		if (owner_)
+			::shm_unlink(name_.c_str());
+	}
+
+	bool ShmRing::push(const float* x, std::size_t xLen, const float* y, std::size_t yLen, int timeoutMs)
+	{
+		if (xLen + yLen > slotFloats_)
+			throw std::runtime_error("Batch does not fit in a shared ring slot ("
+				+ std::to_string(xLen + yLen) + " > " + std::to_string(slotFloats_) + " floats)");
+
+		if (!waitForSpace_(timeoutMs))
+			return false;
+
+		publish_(KindBatch, x, xLen, y, yLen);
+		return true;
+	}
+
+	bool ShmRing::endEpoch(int timeoutMs)
+	{
+		if (!waitForSpace_(timeoutMs))
+			return false;
+
+		publish_(KindEndEpoch, nullptr, 0, nullptr, 0);
+		return true;
+	}
+
+	void ShmRing::close()
+	{
+		header_->closed.store(1, std::memory_order_release);
+	}
+
+	ShmRing::Record ShmRing::wait() const
+	{
+		const auto tail = header_->tail.load(std::memory_order_relaxed);
+		unsigned spins = 0;
+
+		while (true)
+		{
+			if (header_->head.load(std::memory_order_acquire) != tail)
+				return slotAt_(tail)->kind == KindEndEpoch ? Record::EndEpoch : Record::Batch;
+
+			// closed viene scritto dopo l'ultimo push: ricontrollo head prima di arrendermi
+			if (header_->closed.load(std::memory_order_acquire) != 0
+				&& header_->head.load(std::memory_order_acquire) == tail)
+				return Record::Closed;
+
+			backoff(spins);
+		}
+	}
+
+	void ShmRing::popBatch(std::vector<float>& x, std::vector<float>& y)
+	{
+		const auto tail = header_->tail.load(std::memory_order_relaxed);
+		const auto* slot = slotAt_(tail);
+		const auto* values = reinterpret_cast<const float*>(slot + 1);
+
+		// I contatori arrivano dall'altro processo: letti una volta e verificati prima della copia
+		const uint64_t xCount = slot->xCount;
+		const uint64_t yCount = slot->yCount;
+
+		if (xCount > slotFloats_ || yCount > slotFloats_ - xCount)
+			throw std::runtime_error("Corrupt batch in shared ring: " + name_ + " ("
+				+ std::to_string(xCount) + " + " + std::to_string(yCount) + " > " + std::to_string(slotFloats_) + " floats)");
+
+		x.assign(values, values + xCount);
+		y.assign(values + xCount, values + xCount + yCount);
+
+		header_->tail.store(tail + 1, std::memory_order_release);
+	}
+
+	void ShmRing::skip()
+	{
+		const auto tail = header_->tail.load(std::memory_order_relaxed);
+		header_->tail.store(tail + 1, std::memory_order_release);
+	}
+
+	std::size_t ShmRing::slots() const { return slots_; }
+
+	std::size_t ShmRing::slotFloats() const { return slotFloats_; }
+
+	const std::string& ShmRing::name() const { return name_; }
+
+	void ShmRing::map_(int fd, std::size_t bytes)
+	{
+		void* mapped = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+
+		if (mapped == MAP_FAILED)
+		{
+			if (owner_)
+				::shm_unlink(name_.c_str());
+			throw std::runtime_error("Unable to mmap shared ring: " + name_);
+		}
+
+		mapped_ = mapped;
+		mappedBytes_ = bytes;
+		slotsBase_ = static_cast<unsigned char*>(mapped) + sizeof(Header_);
+	}
+
+	ShmRing::Slot_* ShmRing::slotAt_(uint64_t pos) const
+	{
+		return reinterpret_cast<Slot_*>(slotsBase_ + (pos % slots_) * slotBytes_);
+	}
+
+	bool ShmRing::waitForSpace_(int timeoutMs) const
+	{
+		if (header_->closed.load(std::memory_order_relaxed) != 0)
+			throw std::runtime_error("Shared ring is closed: " + name_);
+
+		const auto head = header_->head.load(std::memory_order_relaxed);
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+		unsigned spins = 0;
+
+		while (head - header_->tail.load(std::memory_order_acquire) >= slots_)
+		{
+			if (timeoutMs >= 0 && std::chrono::steady_clock::now() >= deadline)
+				return false;
+
+			backoff(spins);
+		}
+
+		return true;
+	}
+
+	void ShmRing::publish_(uint32_t kind, const float* x, std::size_t xLen, const float* y, std::size_t yLen)
+	{
+		const auto head = header_->head.load(std::memory_order_relaxed);
+		auto* slot = slotAt_(head);
+		auto* values = reinterpret_cast<float*>(slot + 1);
+
+		slot->kind = kind;
+		slot->xCount = xLen;
+		slot->yCount = yLen;
+
+		if (xLen > 0)
+			std::memcpy(values, x, xLen * sizeof(float));
+		if (yLen > 0)
+			std::memcpy(values + xLen, y, yLen * sizeof(float));
+
+		header_->head.store(head + 1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Ring buffer single-producer/single-consumer su memoria condivisa POSIX (shm_open).
+	// Ogni slot contiene un batch già impacchettato (x e y in float) oppure un marcatore
+	// di fine epoca. Il producer (PHP via FFI o un altro processo) crea il ring, il
+	// trainer lo apre per nome e consuma i batch senza passare da file o testo.
+	class ShmRing
+	{
+	public:
+		enum class Record
+		{
+			Batch,
+			EndEpoch,
+			Closed   // il producer ha chiuso e non ci sono più slot da leggere
+		};
+
+		// Crea (o ricrea) il segmento: slots batch in volo da al massimo slotFloats valori (x + y)
+		ShmRing(const std::string& name, std::size_t slots, std::size_t slotFloats);
+
+		// Apre un segmento esistente creato dal producer
+		explicit ShmRing(const std::string& name);
+
+		~ShmRing();
+
+		ShmRing(const ShmRing&) = delete;
+		ShmRing& operator=(const ShmRing&) = delete;
+
+		// Producer. timeoutMs < 0 attende senza limite; false se il ring è rimasto pieno
+		bool push(const float* x, std::size_t xLen, const float* y, std::size_t yLen, int timeoutMs = -1);
+		bool endEpoch(int timeoutMs = -1);
+		void close();
+
+		// Consumer: attende il prossimo record senza consumarlo
+		Record wait() const;
+		// Copia il batch in testa in x/y (riusando la loro capacità) e libera lo slot
+		void popBatch(std::vector<float>& x, std::vector<float>& y);
+		// Scarta il record in testa (marcatore di fine epoca)
+		void skip();
+
+		std::size_t slots() const;
+		std::size_t slotFloats() const;
+		const std::string& name() const;
+
+	private:
+		struct Header_;
+		struct Slot_;
+
+		std::string name_;
+		bool owner_ = false;
+		void* mapped_ = nullptr;
+		std::size_t mappedBytes_ = 0;
+		Header_* header_ = nullptr;
+		unsigned char* slotsBase_ = nullptr;
+		std::size_t slots_ = 0;
+		std::size_t slotFloats_ = 0;
+		std::size_t slotBytes_ = 0;
+
+		void map_(int fd, std::size_t bytes);
+		Slot_* slotAt_(uint64_t pos) const;
+		bool waitForSpace_(int timeoutMs) const;
+		void publish_(uint32_t kind, const float* x, std::size_t xLen, const float* y, std::size_t yLen);
+	};
+}
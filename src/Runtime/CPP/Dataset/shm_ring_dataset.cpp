@@ -0,0 +1,55 @@
+#include <string>
+#include <vector>
+
+#include "shm_ring_dataset.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	ShmRingDataset::ShmRingDataset(const std::string& name)
+		: ring_(name)
+	{
+	}
+
+	std::size_t ShmRingDataset::numBatches() const { return lastEpochBatches_; }
+
+	bool ShmRingDataset::closed() const { return closed_; }
+
+	void ShmRingDataset::shuffleEpoch()
+	{
+		resetEpoch();
+	}
+
+	void ShmRingDataset::resetEpoch()
+	{
+		epochBatches_ = 0;
+	}
+
+	bool ShmRingDataset::nextBatch()
+	{
+		if (closed_)
+			return false;
+
+		switch (ring_.wait())
+		{
+			case ShmRing::Record::Batch:
+				return true;
+			case ShmRing::Record::EndEpoch:
+				ring_.skip();
+				lastEpochBatches_ = epochBatches_;
+				return false;
+			case ShmRing::Record::Closed:
+				closed_ = true;
+				lastEpochBatches_ = epochBatches_;
+				return false;
+		}
+
+		return false;
+	}
+
+	void ShmRingDataset::pack(std::vector<float>& xPacked, std::vector<float>& yPacked)
+	{
+		// Una sola copia: dallo slot condiviso al buffer che diventa il tensore di input
+		ring_.popBatch(xPacked, yPacked);
+		++epochBatches_;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Dataset.hpp"
+#include "shm_ring.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Dataset alimentato da un altro processo attraverso uno ShmRing: l'ordine dei batch
+	// e la fine di ogni epoca li decide il producer. Il trainer consuma mentre il
+	// producer prepara i batch successivi
+	class ShmRingDataset final : public Dataset
+	{
+	public:
+		explicit ShmRingDataset(const std::string& name);
+
+		// Batch dell'ultima epoca completa (il numero non è noto in anticipo)
+		std::size_t numBatches() const override;
+
+		// L'ordine lo decide il producer: nessuno shuffle locale
+		void shuffleEpoch() override;
+		void resetEpoch() override;
+
+		// Attende il prossimo batch: false al marcatore di fine epoca o a ring chiuso
+		bool nextBatch() override;
+
+		void pack(std::vector<float>& xPacked, std::vector<float>& yPacked) override;
+
+		bool closed() const override;
+
+	private:
+		ShmRing ring_;
+		std::size_t epochBatches_ = 0;
+		std::size_t lastEpochBatches_ = 0;
+		bool closed_ = false;
+	};
+}
@@ -1,39 +1,89 @@
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <fstream>
+#include <glob.h>
 #include <iostream>
 #include <random>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
-#include <iostream>
 
 #include "stream_file_dataset.hpp"
+#include "../Utility/state_stream.hpp"
 
 namespace PHP2xAI::Runtime::CPP
 {
 	StreamFileDataset::StreamFileDataset(std::string path,
 										std::size_t batchSize,
 										char delimiter,
-										uint32_t seed)
-		: path_(std::move(path)),
+										uint32_t seed,
+										std::size_t readers)
+		: StreamFileDataset(expandPaths(path), batchSize, delimiter, seed, readers)
+	{
+		path_ = std::move(path);
+	}
+
+	StreamFileDataset::StreamFileDataset(std::vector<std::string> paths,
+										std::size_t batchSize,
+										char delimiter,
+										uint32_t seed,
+										std::size_t readers)
+		: path_(paths.empty() ? std::string() : paths.front()),
 		batchSize_(batchSize),
 		delimiter_(delimiter),
+		readers_(std::max<std::size_t>(readers, 1)),
 		rng_(seed)
 	{
 		if (batchSize_ == 0)
 			throw std::runtime_error("batchSize must be > 0");
 
-		file_.open(path_);
-		if (!file_.is_open())
-			throw std::runtime_error("Unable to open dataset file: " + path_);
+		if (paths.empty())
+			throw std::runtime_error("Dataset has no files");
+
+		for (auto& p : paths)
+		{
+			auto shard = std::make_unique<Shard_>();
+			shard->path = std::move(p);
+			shard->file.open(shard->path);
+			if (!shard->file.is_open())
+				throw std::runtime_error("Unable to open dataset file: " + shard->path);
+
+			shards_.push_back(std::move(shard));
+		}
 
 		buildBatchOffsets_();
 		resetOrder_();
-			resetEpoch_();
+		resetEpoch_();
+	}
+
+	std::vector<std::string> StreamFileDataset::expandPaths(const std::string& pattern)
+	{
+		if (pattern.find_first_of("*?[") == std::string::npos)
+			return {pattern};
+
+		glob_t matches{};
+		const int rc = ::glob(pattern.c_str(), 0, nullptr, &matches);
+
+		std::vector<std::string> paths;
+		if (rc == 0)
+		{
+			for (std::size_t i = 0; i < matches.gl_pathc; ++i)
+				paths.emplace_back(matches.gl_pathv[i]);
 		}
+		::globfree(&matches);
+
+		if (paths.empty())
+			throw std::runtime_error("No dataset file matches: " + pattern);
+
+		return paths;
+	}
 
 	void StreamFileDataset::printVec(const char* label, const std::vector<float>& v)
 	{
@@ -46,11 +96,58 @@ namespace PHP2xAI::Runtime::CPP
 		std::cout << "]";
 	}
 
-	std::size_t StreamFileDataset::numBatches() const { return batchOffsets_.size(); }
+	void StreamFileDataset::enableCache(std::size_t budgetBytes)
+	{
+		dropPrefetch_();
+
+		cacheBudget_ = budgetBytes;
+		for (auto& shard : shards_)
+			shard->cache.resize(shard->batchOffsets.size());
+	}
+
+	std::size_t StreamFileDataset::cachedBytes() const { return cacheBytes_.load(); }
+
+	void StreamFileDataset::enableTailing(bool enabled)
+	{
+		tailing_ = enabled;
+	}
+
+	std::size_t StreamFileDataset::refresh()
+	{
+		dropPrefetch_();
+
+		const auto before = numLines_;
+		buildBatchOffsets_();
+		trimOrder_();
+
+		return numLines_ > before ? numLines_ - before : 0;
+	}
+
+	std::size_t StreamFileDataset::numBatches() const { return batchOrder_.size(); }
+
+	std::size_t StreamFileDataset::numLines() const { return numLines_; }
+
+	std::size_t StreamFileDataset::numShards() const { return shards_.size(); }
 
 	void StreamFileDataset::shuffleEpoch()
 	{
-		std::shuffle(batchOrder_.begin(), batchOrder_.end(), rng_);
+		dropPrefetch_();
+
+		if (tailing_)
+			refresh();
+
+		// Shuffle a due livelli: ordine degli shard e ordine dei batch dentro ogni shard
+		std::shuffle(shardOrder_.begin(), shardOrder_.end(), rng_);
+		for (auto& shard : shards_)
+		{
+			// Batch arrivati con il tailing: si aggiungono alla permutazione prima dello shuffle
+			for (auto b = shard->order.size(); b < shard->batchOffsets.size(); ++b)
+				shard->order.push_back(b);
+
+			std::shuffle(shard->order.begin(), shard->order.end(), rng_);
+		}
+
+		interleaveOrder_();
 		resetEpoch_();
 	}
 
@@ -64,9 +161,9 @@ namespace PHP2xAI::Runtime::CPP
 		if (curBatchPos_ >= batchOrder_.size()) return false;
 
 		curInBatch_ = 0;
-		seekToBatchStart_(batchOrder_[curBatchPos_]);
+		positioned_ = false;
 
-		// Il batch corrente è pronto: ora chiamerai nextSampleInBatch()
+		// Il batch corrente è pronto: ora chiamerai nextSampleInBatch() o pack()
 		return true;
 	}
 
@@ -75,6 +172,20 @@ namespace PHP2xAI::Runtime::CPP
 		x.clear();
 		y.clear();
 
+		if (curBatchPos_ >= batchOrder_.size())
+			return false;
+
+		const auto ref = batchOrder_[curBatchPos_];
+		auto& file = shards_[ref.shard]->file;
+
+		if (!positioned_)
+		{
+			// La lettura riga per riga usa lo stream dello shard: niente prefetch in volo
+			dropPrefetch_();
+			seekToBatchStart_(ref);
+			positioned_ = true;
+		}
+
 		while (true) {
 			if (curInBatch_ >= batchSize_)
 			{
@@ -83,7 +194,7 @@ namespace PHP2xAI::Runtime::CPP
 			}
 
 			std::string line;
-			if (!std::getline(file_, line))
+			if (!std::getline(file, line))
 			{
 				++curBatchPos_;
 				return false;
@@ -102,98 +213,543 @@ namespace PHP2xAI::Runtime::CPP
 
 	void StreamFileDataset::pack(std::vector<float>& xPacked, std::vector<float>& yPacked)
 	{
-		xPacked.clear();
-		yPacked.clear();
+		if (curBatchPos_ >= batchOrder_.size())
+		{
+			xPacked.clear();
+			yPacked.clear();
+			return;
+		}
 
-		std::vector<float> x;
-		std::vector<float> y;
+		if (readers_ <= 1)
+		{
+			// Parsing direttamente nei buffer del chiamante (la capacità viene riusata)
+			readBatch_(batchOrder_[curBatchPos_], xPacked, yPacked);
+			++curBatchPos_;
+			return;
+		}
 
-		while (true)
+		if (prefetch_.empty())
+			prefetchPos_ = curBatchPos_;
+
+		schedulePrefetch_();
+		auto batch = prefetch_.front().get();
+		prefetch_.pop_front();
+		++curBatchPos_;
+
+		// Scambio dei buffer: i vecchi buffer del chiamante tornano ai reader
+		xPacked.swap(batch.x);
+		yPacked.swap(batch.y);
+		if (spare_.size() < readers_)
+			spare_.push_back(std::move(batch));
+
+		schedulePrefetch_();
+	}
+
+	bool StreamFileDataset::hasState() const { return true; }
+
+	void StreamFileDataset::saveState(StateWriter& out) const
+	{
+		out.rng(rng_);
+		out.vector(shardOrder_);
+		out.u64(shards_.size());
+		for (const auto& shard : shards_)
+			out.vector(shard->order);
+		out.u64(curBatchPos_);
+	}
+
+	void StreamFileDataset::loadState(StateReader& in)
+	{
+		dropPrefetch_();
+
+		in.rng(rng_);
+		auto shardOrder = in.vector<std::size_t>();
+
+		if (in.u64() != shards_.size() || shardOrder.size() != shards_.size())
+			throw std::runtime_error("Training state does not match the dataset shards: " + path_);
+
+		for (auto& shard : shards_)
 		{
-			if (curInBatch_ >= batchSize_)
+			auto order = in.vector<std::size_t>();
+
+			// Con il tailing il file può essere cresciuto: basta che i batch salvati esistano ancora
+			for (auto b : order)
+				if (b >= shard->batchOffsets.size())
+					throw std::runtime_error("Training state does not match the dataset file: " + shard->path);
+
+			shard->order = std::move(order);
+		}
+
+		shardOrder_ = std::move(shardOrder);
+		interleaveOrder_();
+
+		const auto pos = static_cast<std::size_t>(in.u64());
+		if (pos > batchOrder_.size())
+			throw std::runtime_error("Training state batch position out of range: " + path_);
+
+		resetEpoch_();
+		curBatchPos_ = pos;
+		prefetchPos_ = pos;
+	}
+
+	void StreamFileDataset::readBatch_(const BatchRef_& ref, std::vector<float>& x, std::vector<float>& y) const
+	{
+		auto& shard = *shards_[ref.shard];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		if (cacheBudget_ > 0 && shard.cache[ref.batch].ready)
+		{
+			decodeValues_(shard.cache[ref.batch].x, x);
+			decodeValues_(shard.cache[ref.batch].y, y);
+			return;
+		}
+
+		shard.file.clear();
+		shard.file.seekg(shard.batchOffsets.at(ref.batch));
+		if (!shard.file) throw std::runtime_error("seekg failed on dataset file: " + shard.path);
+
+		x.clear();
+		y.clear();
+
+		// Solo le righe indicizzate: con il tailing il file può già contenere righe nuove
+		const auto lines = std::min(batchSize_, shard.numLines - ref.batch * batchSize_);
+
+		std::string line;
+		std::size_t rows = 0;
+
+		for (std::size_t l = 0; l < lines && std::getline(shard.file, line); ++l)
+		{
+			if (isBlank_(line))
+				continue;
+
+			parseLineXY_(line, x, y);
+
+			if (rows == 0)
 			{
-				++curBatchPos_;
-				break;
+				x.reserve(x.size() * batchSize_);
+				y.reserve(y.size() * batchSize_);
 			}
 
-			std::string line;
-			if (!std::getline(file_, line))
+			++rows;
+		}
+
+		if (cacheBudget_ > 0)
+			storeInCache_(shard.cache[ref.batch], x, y, rows);
+	}
+
+	void StreamFileDataset::dropCached_(CachedBatch_& cached) const
+	{
+		if (!cached.ready)
+			return;
+
+		cacheBytes_ -= cached.x.bytes.size() + cached.y.bytes.size();
+		cached = CachedBatch_{};
+	}
+
+	void StreamFileDataset::storeInCache_(CachedBatch_& cached, const std::vector<float>& x, const std::vector<float>& y, std::size_t rows) const
+	{
+		CachedBatch_ entry;
+		encodeValues_(x, rows, entry.x);
+		encodeValues_(y, rows, entry.y);
+
+		// Il budget è condiviso tra i reader: si prenota lo spazio prima di tenere il batch
+		const auto bytes = entry.x.bytes.size() + entry.y.bytes.size();
+		auto current = cacheBytes_.load();
+
+		do
+		{
+			if (current + bytes > cacheBudget_)
+				return;
+		}
+		while (!cacheBytes_.compare_exchange_weak(current, current + bytes));
+
+		entry.ready = true;
+		cached = std::move(entry);
+	}
+
+	void StreamFileDataset::encodeValues_(const std::vector<float>& values, std::size_t rows, CachedValues_& out)
+	{
+		// Righe di lunghezza diversa: i valori restano una sola colonna
+		if (rows == 0 || values.size() % rows != 0)
+			rows = values.size();
+
+		const std::size_t cols = rows > 0 ? values.size() / rows : 0;
+
+		out.rows = rows;
+		out.columns.assign(cols, Encoding_::Float);
+
+		// Per ogni colonna il formato più compatto che rappresenta i suoi valori senza perdita
+		std::size_t bytes = 0;
+
+		for (std::size_t c = 0; c < cols; ++c)
+		{
+			float maxVal = 0.0f;
+			bool integral = true;
+
+			for (std::size_t r = 0; r < rows; ++r)
 			{
-				++curBatchPos_;
-				break;
+				const float v = values[r * cols + c];
+				if (!(v >= 0.0f && v <= 65535.0f) || v != std::floor(v))
+				{
+					integral = false;
+					break;
+				}
+				maxVal = std::max(maxVal, v);
 			}
 
-			if (isBlank_(line))
+			if (integral)
+				out.columns[c] = maxVal <= 255.0f ? Encoding_::UInt8 : Encoding_::UInt16;
+
+			bytes += rows * encodedSize_(out.columns[c]);
+		}
+
+		out.bytes.assign(bytes, 0);
+		uint8_t* dst = out.bytes.data();
+
+		for (std::size_t c = 0; c < cols; ++c)
+		{
+			for (std::size_t r = 0; r < rows; ++r)
 			{
-				continue;
+				const float v = values[r * cols + c];
+
+				switch (out.columns[c])
+				{
+					case Encoding_::UInt8:
+						*dst = static_cast<uint8_t>(v);
+						break;
+					case Encoding_::UInt16:
+					{
+						const auto u = static_cast<uint16_t>(v);
+						std::memcpy(dst, &u, sizeof(u));
+						break;
+					}
+					case Encoding_::Float:
+						std::memcpy(dst, &v, sizeof(v));
+						break;
+				}
+
+				dst += encodedSize_(out.columns[c]);
 			}
+		}
+	}
 
-			parseLineXY_(line, x, y);
+	std::size_t StreamFileDataset::encodedSize_(Encoding_ encoding)
+	{
+		switch (encoding)
+		{
+			case Encoding_::UInt8:
+				return sizeof(uint8_t);
+			case Encoding_::UInt16:
+				return sizeof(uint16_t);
+			case Encoding_::Float:
+				break;
+		}
 
-			xPacked.insert(xPacked.end(), x.begin(), x.end());
-			yPacked.insert(yPacked.end(), y.begin(), y.end());
+		return sizeof(float);
+	}
 
-			++curInBatch_;
+	void StreamFileDataset::decodeValues_(const CachedValues_& values, std::vector<float>& out)
+	{
+		const std::size_t rows = values.rows;
+		const std::size_t cols = values.columns.size();
+		const uint8_t* src = values.bytes.data();
+
+		out.resize(rows * cols);
+
+		for (std::size_t c = 0; c < cols; ++c)
+		{
+			switch (values.columns[c])
+			{
+				case Encoding_::UInt8:
+					for (std::size_t r = 0; r < rows; ++r)
+						out[r * cols + c] = static_cast<float>(src[r]);
+					src += rows;
+					break;
+				case Encoding_::UInt16:
+					for (std::size_t r = 0; r < rows; ++r)
+					{
+						uint16_t v;
+						std::memcpy(&v, src + r * sizeof(uint16_t), sizeof(v));
+						out[r * cols + c] = static_cast<float>(v);
+					}
+					src += rows * sizeof(uint16_t);
+					break;
+				case Encoding_::Float:
+					for (std::size_t r = 0; r < rows; ++r)
+						std::memcpy(&out[r * cols + c], src + r * sizeof(float), sizeof(float));
+					src += rows * sizeof(float);
+					break;
+			}
+		}
+	}
+
+	void StreamFileDataset::schedulePrefetch_()
+	{
+		while (prefetchPos_ < batchOrder_.size() && prefetch_.size() < readers_)
+		{
+			const auto ref = batchOrder_[prefetchPos_++];
+
+			PackedBatch_ buffers;
+			if (!spare_.empty())
+			{
+				buffers = std::move(spare_.back());
+				spare_.pop_back();
+			}
+
+			prefetch_.push_back(std::async(std::launch::async,
+				[this, ref, buffers = std::move(buffers)]() mutable
+				{
+					readBatch_(ref, buffers.x, buffers.y);
+					return std::move(buffers);
+				}));
+		}
+	}
+
+	void StreamFileDataset::dropPrefetch_()
+	{
+		// Attende i batch in volo (e ne scarta eventuali eccezioni) prima di toccare gli stream
+		for (auto& pending : prefetch_)
+		{
+			if (pending.valid())
+				pending.wait();
 		}
+
+		prefetch_.clear();
+		prefetchPos_ = curBatchPos_;
 	}
 
 	void StreamFileDataset::resetOrder_()
 	{
-		batchOrder_.resize(batchOffsets_.size());
-		for (std::size_t i = 0; i < batchOrder_.size(); ++i) batchOrder_[i] = i;
+		shardOrder_.resize(shards_.size());
+		for (std::size_t s = 0; s < shardOrder_.size(); ++s) shardOrder_[s] = s;
+
+		for (auto& shard : shards_)
+		{
+			shard->order.resize(shard->batchOffsets.size());
+			for (std::size_t i = 0; i < shard->order.size(); ++i) shard->order[i] = i;
+		}
+
+		interleaveOrder_();
+	}
+
+	void StreamFileDataset::interleaveOrder_()
+	{
+		// Round-robin tra gli shard: batch consecutivi arrivano da file diversi,
+		// così i reader in parallelo non si contendono lo stesso stream
+		std::size_t total = 0;
+		for (const auto& shard : shards_)
+			total += shard->order.size();
+
+		batchOrder_.clear();
+		batchOrder_.reserve(total);
+
+		for (std::size_t k = 0; ; ++k)
+		{
+			bool any = false;
+
+			for (std::size_t s : shardOrder_)
+			{
+				const auto& order = shards_[s]->order;
+				if (k >= order.size())
+					continue;
+
+				batchOrder_.push_back({s, order[k]});
+				any = true;
+			}
+
+			if (!any)
+				break;
+		}
+	}
+
+	void StreamFileDataset::trimOrder_()
+	{
+		// Il batch con la riga aperta può uscire dall'indice (la riga viene riletta al prossimo
+		// refresh): il suo id esce dalla permutazione dello shard e dall'ordine dell'epoca
+		bool trimmed = false;
+		for (auto& shard : shards_)
+		{
+			const auto count = shard->batchOffsets.size();
+			const auto before = shard->order.size();
+
+			shard->order.erase(
+				std::remove_if(shard->order.begin(), shard->order.end(), [count](std::size_t b) { return b >= count; }),
+				shard->order.end());
+
+			trimmed = trimmed || shard->order.size() != before;
+		}
+
+		if (!trimmed)
+			return;
+
+		std::size_t kept = 0;
+		auto pos = curBatchPos_;
+
+		for (std::size_t i = 0; i < batchOrder_.size(); ++i)
+		{
+			const auto ref = batchOrder_[i];
+
+			if (ref.batch < shards_[ref.shard]->batchOffsets.size())
+			{
+				batchOrder_[kept++] = ref;
+				continue;
+			}
+
+			if (i < curBatchPos_)
+				--pos;
+			else if (i == curBatchPos_)
+			{
+				curInBatch_ = 0;
+				positioned_ = false;
+			}
+		}
+
+		batchOrder_.resize(kept);
+		curBatchPos_ = pos;
+		prefetchPos_ = pos;
 	}
 
 	void StreamFileDataset::resetEpoch_()
 	{
+		dropPrefetch_();
+
 		curBatchPos_ = 0;
 		curInBatch_ = 0;
-		file_.clear();
-		file_.seekg(0);
+		positioned_ = false;
+		prefetchPos_ = 0;
 	}
 
 	void StreamFileDataset::buildBatchOffsets_()
 	{
-		batchOffsets_.clear();
 		numLines_ = 0;
 
-		file_.clear();
-		file_.seekg(0);
+		const auto workers = std::min(readers_, shards_.size());
 
-		std::string line;
-		while (true)
+		if (workers <= 1)
+		{
+			for (auto& shard : shards_)
+				buildShardOffsets_(*shard);
+		}
+		else
 		{
-			std::streampos pos = file_.tellg();
-			if (!std::getline(file_, line)) break;
+			// Indicizzazione degli shard in parallelo: ogni worker prende il prossimo shard libero
+			std::atomic<std::size_t> next{0};
+			std::vector<std::exception_ptr> errors(workers);
+			std::vector<std::thread> threads;
+			threads.reserve(workers);
 
-			if ((numLines_ % batchSize_) == 0)
+			for (std::size_t w = 0; w < workers; ++w)
 			{
-				batchOffsets_.push_back(pos);
+				threads.emplace_back([this, &next, &errors, w]()
+				{
+					try
+					{
+						for (std::size_t s = next++; s < shards_.size(); s = next++)
+							buildShardOffsets_(*shards_[s]);
+					}
+					catch (...)
+					{
+						errors[w] = std::current_exception();
+					}
+				});
 			}
 
-			++numLines_;
+			for (auto& t : threads)
+				t.join();
+
+			for (const auto& error : errors)
+			{
+				if (error)
+					std::rethrow_exception(error);
+			}
 		}
 
-		if (batchOffsets_.empty())
+		for (const auto& shard : shards_)
+			numLines_ += shard->numLines;
+
+		if (numLines_ == 0)
 		{
 			throw std::runtime_error("Dataset is empty: " + path_);
 		}
-
-		file_.clear();
-		file_.seekg(0);
 	}
 
-	void StreamFileDataset::seekToBatchStart_(std::size_t batchId)
+	void StreamFileDataset::buildShardOffsets_(Shard_& shard) const
 	{
-		const std::streampos off = batchOffsets_.at(batchId);
-		file_.clear();
-		file_.seekg(off);
-		if (!file_) throw std::runtime_error("seekg failed on dataset file");
+		// Incrementale: riparte da indexedEnd (0 alla prima chiamata). Un'ultima riga senza '\n'
+		// può essere ancora in scrittura: viene tolta dall'indice e riletta
+		const bool reopened = shard.openTail;
+		if (shard.openTail)
+		{
+			--shard.numLines;
+			if ((shard.numLines % batchSize_) == 0)
+				shard.batchOffsets.pop_back();
+
+			shard.indexedEnd = shard.tailStart;
+			shard.openTail = false;
+		}
+
+		const auto before = shard.numLines;
+
+		shard.file.clear();
+		shard.file.seekg(shard.indexedEnd);
+
+		std::string line;
+		while (true)
+		{
+			std::streampos pos = shard.file.tellg();
+			if (!std::getline(shard.file, line))
+			{
+				// Fine dell'ultima riga completa: da qui riparte il prossimo refresh
+				if (!shard.openTail)
+					shard.indexedEnd = pos;
+				break;
+			}
+
+			// Con il tailing la riga senza '\n' è ancora in scrittura: la legge il prossimo refresh
+			if (tailing_ && shard.file.eof())
+			{
+				shard.indexedEnd = pos;
+				break;
+			}
+
+			if ((shard.numLines % batchSize_) == 0)
+			{
+				shard.batchOffsets.push_back(pos);
+			}
+
+			++shard.numLines;
+
+			if (shard.file.eof())
+			{
+				shard.openTail = true;
+				shard.tailStart = pos;
+			}
+		}
+
+		shard.file.clear();
+		shard.file.seekg(0);
+
+		if (cacheBudget_ > 0)
+		{
+			// Il batch che era parziale (o con la riga aperta) è cambiato: va riletto
+			const auto touched = before / batchSize_;
+			if ((reopened || shard.numLines != before) && touched < shard.cache.size())
+				dropCached_(shard.cache[touched]);
+
+			// Batch usciti dall'indice (riga aperta tolta): liberati prima di ridurre la cache
+			for (auto b = shard.batchOffsets.size(); b < shard.cache.size(); ++b)
+				dropCached_(shard.cache[b]);
+
+			shard.cache.resize(shard.batchOffsets.size());
+		}
 	}
 
-	bool StreamFileDataset::isBlank_(const std::string& s)
+	void StreamFileDataset::seekToBatchStart_(const BatchRef_& ref)
 	{
-		for (unsigned char c : s) if (!std::isspace(c)) return false;
-		return true;
+		auto& shard = *shards_[ref.shard];
+		const std::streampos off = shard.batchOffsets.at(ref.batch);
+		shard.file.clear();
+		shard.file.seekg(off);
+		if (!shard.file) throw std::runtime_error("seekg failed on dataset file");
 	}
 
 	void StreamFileDataset::parseLineXY_(const std::string& line, std::vector<float>& x, std::vector<float>& y) const
@@ -206,20 +762,15 @@ namespace PHP2xAI::Runtime::CPP
 		std::string_view left(line.data(), p);
 		std::string_view right(line.data() + p + 1, line.size() - (p + 1));
 
+		// Accoda a x/y: pack() scrive così direttamente nel buffer del batch
+		const auto xSize = x.size();
+		const auto ySize = y.size();
+
 		parseFloatVector_(left, x);
 		parseFloatVector_(right, y);
 
-		if (x.empty() || y.empty()) {
+		if (x.size() == xSize || y.size() == ySize) {
 			throw std::runtime_error("Invalid line (empty x or y): " + line);
 		}
 	}
-
-	void StreamFileDataset::parseFloatVector_(std::string_view sv, std::vector<float>& out)
-	{
-		out.clear();
-		std::string s(sv);
-		std::istringstream iss(s);
-		float v;
-		while (iss >> v) out.push_back(v);
-	}
 }
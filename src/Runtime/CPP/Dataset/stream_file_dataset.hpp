@@ -1,61 +1,170 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "Dataset.hpp"
+
 namespace PHP2xAI::Runtime::CPP
 {
-	class StreamFileDataset
+	class StreamFileDataset final : public Dataset
 	{
 	public:
+		// path può essere un file singolo o un glob (es. "data/train-*.txt")
 		explicit StreamFileDataset(std::string path,
 								std::size_t batchSize,
 								char delimiter = '|',
-								uint32_t seed = 42);
+								uint32_t seed = 42,
+								std::size_t readers = 1);
+
+		// Dataset diviso in shard: i batch vengono interlacciati tra gli shard.
+		// readers > 1 legge in parallelo fino a readers batch (da shard diversi)
+		explicit StreamFileDataset(std::vector<std::string> paths,
+								std::size_t batchSize,
+								char delimiter = '|',
+								uint32_t seed = 42,
+								std::size_t readers = 1);
+
+		// Cache in memoria dei batch decodificati (opt-in): dalla seconda epoca i batch
+		// in cache non rileggono il file. Oltre budgetBytes i batch restano in streaming
+		void enableCache(std::size_t budgetBytes);
+		std::size_t cachedBytes() const;
 
-		std::size_t numBatches() const;
+		// File in sola aggiunta (es. log di produzione): a ogni shuffleEpoch() l'indice riprende
+		// dall'ultima fine file nota e i nuovi batch completi entrano nello shuffle
+		void enableTailing(bool enabled = true);
 
-		void shuffleEpoch();
-		void resetEpoch();
+		// Estende l'indice con le righe complete aggiunte ai file, ritorna quante sono.
+		// I nuovi batch entrano nell'ordine alla prossima shuffleEpoch()
+		std::size_t refresh();
+
+		std::size_t numBatches() const override;
+		std::size_t numLines() const;
+		std::size_t numShards() const;
+
+		void shuffleEpoch() override;
+		void resetEpoch() override;
 
 		// Equivalente del foreach($dataset as $batch)
-		bool nextBatch();
+		bool nextBatch() override;
 
 		// Equivalente del foreach($batch as [$x,$y])
 		bool nextSampleInBatch(std::vector<float>& x, std::vector<float>& y);
 
-		// Pack del batch corrente in row-major: ritorna xPacked e yPacked
-		void pack(std::vector<float>& xPacked, std::vector<float>& yPacked);
-		
+		// Pack del batch corrente in row-major: ritorna xPacked e yPacked.
+		// I buffer passati vengono riusati (o scambiati), passare sempre gli stessi vettori
+		void pack(std::vector<float>& xPacked, std::vector<float>& yPacked) override;
+
+		bool hasState() const override;
+		void saveState(StateWriter& out) const override;
+		void loadState(StateReader& in) override;
+
 		// Print the vector
 		static void printVec(const char* label, const std::vector<float>& v);
 
+		// Expand a glob pattern into the sorted list of matching files
+		static std::vector<std::string> expandPaths(const std::string& pattern);
+
 	private:
+		enum class Encoding_ : uint8_t
+		{
+			Float,
+			UInt8,
+			UInt16
+		};
+
+		// Una colonna dopo l'altra, ognuna nel proprio formato (rows valori per colonna)
+		struct CachedValues_
+		{
+			std::size_t rows = 0;
+			std::vector<Encoding_> columns;
+			std::vector<uint8_t> bytes;
+		};
+
+		struct CachedBatch_
+		{
+			bool ready = false;
+			CachedValues_ x;
+			CachedValues_ y;
+		};
+
+		struct Shard_
+		{
+			std::string path;
+			std::ifstream file;
+			std::mutex mutex;                          // serializza le letture concorrenti sullo stesso file
+			std::vector<std::streampos> batchOffsets;  // offset byte di inizio batch (uno ogni batchSize righe)
+			std::vector<std::size_t> order;            // permutazione dei batch dello shard
+			std::vector<CachedBatch_> cache;           // un elemento per batch (se la cache è attiva)
+			std::size_t numLines = 0;
+			std::streampos indexedEnd = 0;             // fine dell'ultima riga indicizzata
+			std::streampos tailStart = 0;              // inizio dell'ultima riga, se senza '\n'
+			bool openTail = false;                     // ultima riga ancora in scrittura (senza '\n')
+		};
+
+		struct BatchRef_
+		{
+			std::size_t shard = 0;
+			std::size_t batch = 0;
+		};
+
+		struct PackedBatch_
+		{
+			std::vector<float> x;
+			std::vector<float> y;
+		};
+
 		std::string path_;
 		std::size_t batchSize_;
 		char delimiter_;
+		std::size_t readers_;
 
 		std::mt19937 rng_;
-		std::ifstream file_;
 
-		std::vector<std::streampos> batchOffsets_; // offset byte di inizio batch (uno ogni batchSize righe)
-		std::vector<std::size_t> batchOrder_;      // permutazione dei batch
+		std::vector<std::unique_ptr<Shard_>> shards_;
+		std::vector<std::size_t> shardOrder_;      // permutazione degli shard
+		std::vector<BatchRef_> batchOrder_;        // ordine dei batch dell'epoca (interlacciato tra gli shard)
 		std::size_t curBatchPos_ = 0;              // posizione nell'ordine dei batch
 		std::size_t curInBatch_ = 0;               // sample letti nel batch corrente
+		bool positioned_ = false;                  // stream dello shard corrente posizionato sul batch
 		std::size_t numLines_ = 0;
 
+		bool tailing_ = false;
+
+		std::size_t cacheBudget_ = 0;
+		mutable std::atomic<std::size_t> cacheBytes_{0};
+
+		// Batch letti in anticipo: coprono le posizioni [curBatchPos_, prefetchPos_)
+		std::deque<std::future<PackedBatch_>> prefetch_;
+		std::vector<PackedBatch_> spare_;          // buffer restituiti da pack(), riusati dai reader
+		std::size_t prefetchPos_ = 0;
+
 		void resetOrder_();
 		void resetEpoch_();
+		void interleaveOrder_();
+		void trimOrder_();
 		void buildBatchOffsets_();
-		void seekToBatchStart_(std::size_t batchId);
+		void buildShardOffsets_(Shard_& shard) const;
+		void seekToBatchStart_(const BatchRef_& ref);
+		void readBatch_(const BatchRef_& ref, std::vector<float>& x, std::vector<float>& y) const;
+		void dropCached_(CachedBatch_& cached) const;
+		void storeInCache_(CachedBatch_& cached, const std::vector<float>& x, const std::vector<float>& y, std::size_t rows) const;
+		static void encodeValues_(const std::vector<float>& values, std::size_t rows, CachedValues_& out);
+		static void decodeValues_(const CachedValues_& values, std::vector<float>& out);
+		static std::size_t encodedSize_(Encoding_ encoding);
+		void schedulePrefetch_();
+		void dropPrefetch_();
 
-		static bool isBlank_(const std::string& s);
 		void parseLineXY_(const std::string& line, std::vector<float>& x, std::vector<float>& y) const;
-		static void parseFloatVector_(std::string_view sv, std::vector<float>& out);
 	};
 }
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "token_stream_dataset.hpp"
+#include "../Utility/state_stream.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	TokenStreamDataset::TokenStreamDataset(std::string path,
+										std::size_t batchSize,
+										std::size_t seqLen,
+										std::size_t tokenBytes,
+										Sampling sampling,
+										std::size_t stride,
+										uint32_t seed)
+		: path_(std::move(path)),
+		batchSize_(batchSize),
+		seqLen_(seqLen),
+		tokenBytes_(tokenBytes),
+		sampling_(sampling),
+		stride_(stride == 0 ? seqLen : stride),
+		rng_(seed)
+	{
+		if (batchSize_ == 0)
+			throw std::runtime_error("batchSize must be > 0");
+
+		if (seqLen_ == 0)
+			throw std::runtime_error("seqLen must be > 0");
+
+		if (tokenBytes_ != 2 && tokenBytes_ != 4)
+			throw std::runtime_error("tokenBytes must be 2 or 4");
+
+		mapFile_();
+		buildWindows_();
+		resetEpoch();
+	}
+
+	TokenStreamDataset::~TokenStreamDataset()
+	{
+		if (tokens_ != nullptr)
+			::munmap(const_cast<unsigned char*>(tokens_), mappedBytes_);
+	}
+
+	TokenStreamDataset::Sampling TokenStreamDataset::parseSampling(const std::string& name)
+	{
+		if (name == "strided")
+			return Sampling::Strided;
+		if (name == "random")
+			return Sampling::Random;
+
+		throw std::runtime_error("Unsupported window sampling: " + name);
+	}
+
+	std::size_t TokenStreamDataset::numBatches() const
+	{
+		return (windows_.size() + batchSize_ - 1) / batchSize_;
+	}
+
+	std::size_t TokenStreamDataset::numTokens() const { return numTokens_; }
+
+	std::size_t TokenStreamDataset::numWindows() const { return windows_.size(); }
+
+	void TokenStreamDataset::shuffleEpoch()
+	{
+		if (sampling_ == Sampling::Random)
+			sampleWindows_();
+		else
+			std::shuffle(windows_.begin(), windows_.end(), rng_);
+
+		resetEpoch();
+	}
+
+	void TokenStreamDataset::resetEpoch()
+	{
+		curBatchPos_ = 0;
+	}
+
+	bool TokenStreamDataset::nextBatch()
+	{
+		return curBatchPos_ < numBatches();
+	}
+
+	void TokenStreamDataset::pack(std::vector<float>& xPacked, std::vector<float>& yPacked)
+	{
+		const auto first = curBatchPos_ * batchSize_;
+		const auto rows = first < windows_.size() ? std::min(batchSize_, windows_.size() - first) : 0;
+
+		xPacked.resize(rows * seqLen_);
+		yPacked.resize(rows * seqLen_);
+
+		for (std::size_t b = 0; b < rows; ++b)
+		{
+			const auto start = windows_[first + b];
+			float* x = xPacked.data() + b * seqLen_;
+			float* y = yPacked.data() + b * seqLen_;
+
+			// y è x spostato di un token: si legge una volta la finestra di seqLen + 1
+			float prev = static_cast<float>(tokenAt_(start));
+			for (std::size_t t = 0; t < seqLen_; ++t)
+			{
+				const float next = static_cast<float>(tokenAt_(start + t + 1));
+				x[t] = prev;
+				y[t] = next;
+				prev = next;
+			}
+		}
+
+		++curBatchPos_;
+	}
+
+	bool TokenStreamDataset::hasState() const { return true; }
+
+	void TokenStreamDataset::saveState(StateWriter& out) const
+	{
+		out.rng(rng_);
+		out.vector(windows_);
+		out.u64(curBatchPos_);
+	}
+
+	void TokenStreamDataset::loadState(StateReader& in)
+	{
+		in.rng(rng_);
+		auto windows = in.vector<std::size_t>();
+
+		for (auto start : windows)
+			if (start + seqLen_ + 1 > numTokens_)
+				throw std::runtime_error("Training state does not match the token file: " + path_);
+
+		const auto pos = static_cast<std::size_t>(in.u64());
+		if (pos > (windows.size() + batchSize_ - 1) / batchSize_)
+			throw std::runtime_error("Training state batch position out of range: " + path_);
+
+		windows_ = std::move(windows);
+		curBatchPos_ = pos;
+	}
+
+	void TokenStreamDataset::mapFile_()
+	{
+		const int fd = ::open(path_.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Unable to open token file: " + path_);
+
+		struct stat st{};
+		if (::fstat(fd, &st) != 0)
+		{
+			::close(fd);
+			throw std::runtime_error("Unable to stat token file: " + path_);
+		}
+
+		mappedBytes_ = static_cast<std::size_t>(st.st_size);
+		if (mappedBytes_ % tokenBytes_ != 0)
+		{
+			::close(fd);
+			throw std::runtime_error("Token file size is not a multiple of the token size: " + path_);
+		}
+
+		numTokens_ = mappedBytes_ / tokenBytes_;
+		if (numTokens_ < seqLen_ + 1)
+		{
+			::close(fd);
+			throw std::runtime_error("Token file shorter than one window: " + path_);
+		}
+
+		void* mapped = ::mmap(nullptr, mappedBytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (mapped == MAP_FAILED)
+			throw std::runtime_error("Unable to mmap token file: " + path_);
+
+		tokens_ = static_cast<const unsigned char*>(mapped);
+		::madvise(mapped, mappedBytes_, sampling_ == Sampling::Random ? MADV_RANDOM : MADV_WILLNEED);
+	}
+
+	void TokenStreamDataset::buildWindows_()
+	{
+		// Strided: tutte le finestre a passo stride. Random: stesso numero di finestre
+		// (circa un passaggio sul file per epoca), con inizi estratti a caso
+		const auto lastStart = numTokens_ - seqLen_ - 1;
+
+		if (sampling_ == Sampling::Strided)
+		{
+			windows_.clear();
+			for (std::size_t s = 0; s <= lastStart; s += stride_)
+				windows_.push_back(s);
+			return;
+		}
+
+		windows_.resize(std::max<std::size_t>((numTokens_ - 1) / seqLen_, 1));
+		sampleWindows_();
+	}
+
+	void TokenStreamDataset::sampleWindows_()
+	{
+		std::uniform_int_distribution<std::size_t> dist(0, numTokens_ - seqLen_ - 1);
+		for (auto& start : windows_)
+			start = dist(rng_);
+	}
+
+	std::size_t TokenStreamDataset::tokenAt_(std::size_t pos) const
+	{
+		// File little-endian: lettura diretta sulle piattaforme supportate (x86-64, aarch64)
+		if (tokenBytes_ == 2)
+		{
+			uint16_t tok;
+			std::memcpy(&tok, tokens_ + pos * 2, sizeof(tok));
+			return tok;
+		}
+
+		uint32_t tok;
+		std::memcpy(&tok, tokens_ + pos * 4, sizeof(tok));
+		return tok;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Dataset.hpp"
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Dataset per language model su un file piatto di token (uint16/uint32 little-endian)
+	// mappato in memoria. Ogni sample è una finestra di seqLen token: x = tok[s..s+T),
+	// y = tok[s+1..s+T+1) come label intere per softmax_ce_logits_label_int.
+	class TokenStreamDataset final : public Dataset
+	{
+	public:
+		enum class Sampling
+		{
+			Strided, // finestre a passo fisso, ordine mescolato a ogni epoca
+			Random   // inizi delle finestre estratti a caso a ogni epoca
+		};
+
+		explicit TokenStreamDataset(std::string path,
+									std::size_t batchSize,
+									std::size_t seqLen,
+									std::size_t tokenBytes = 2,
+									Sampling sampling = Sampling::Strided,
+									std::size_t stride = 0,
+									uint32_t seed = 42);
+		~TokenStreamDataset() override;
+
+		TokenStreamDataset(const TokenStreamDataset&) = delete;
+		TokenStreamDataset& operator=(const TokenStreamDataset&) = delete;
+
+		std::size_t numBatches() const override;
+		std::size_t numTokens() const;
+		std::size_t numWindows() const;
+
+		void shuffleEpoch() override;
+		void resetEpoch() override;
+
+		bool nextBatch() override;
+
+		// x = [rows, seqLen] token id, y = [rows, seqLen] token successivi
+		void pack(std::vector<float>& xPacked, std::vector<float>& yPacked) override;
+
+		bool hasState() const override;
+		void saveState(StateWriter& out) const override;
+		void loadState(StateReader& in) override;
+
+		static Sampling parseSampling(const std::string& name);
+
+	private:
+		std::string path_;
+		std::size_t batchSize_;
+		std::size_t seqLen_;
+		std::size_t tokenBytes_;
+		Sampling sampling_;
+		std::size_t stride_;
+
+		std::mt19937 rng_;
+
+		const unsigned char* tokens_ = nullptr;
+		std::size_t mappedBytes_ = 0;
+		std::size_t numTokens_ = 0;
+
+		std::vector<std::size_t> windows_;         // inizio (in token) di ogni finestra dell'epoca
+		std::size_t curBatchPos_ = 0;
+
+		void mapFile_();
+		void buildWindows_();
+		void sampleWindows_();
+		std::size_t tokenAt_(std::size_t pos) const;
+	};
+}
@@ -3,6 +3,7 @@
 namespace PHP2xAI\Runtime\CPP;
 
 use FFI;
+use FFI\CData;
 use RuntimeException;
 use PHP2xAI\Runtime\PHP\Core\GraphRuntime;
 
@@ -82,43 +83,165 @@ class GraphRuntimeCpp extends GraphRuntime
 
 	public function getTensorData(int $id) : array
 	{
-		$n = $this->getTensorSize($id);
-		if ($n === null)
-			throw new RuntimeException("Unknown tensor id: ".$id);
+		return $this->copyOut($this->getTensorDataView($id));
+	}
+
+	public function getTensorGrad(int $id) : array
+	{
+		return $this->copyOut($this->getTensorGradView($id));
+	}
+
+	/**
+	 * float[] over the runtime's own memory, no copy. Once forward() and backward() have run
+	 * it survives further calls to them; fetch it again after a batch size or sequence length
+	 * change, never use it after this runtime is destroyed. Writes go straight into the tensor
+	 */
+	public function getTensorDataView(int $id) : ?CData
+	{
+		$len = $this->ffi->new("size_t[1]");
+		$ptr = $this->ffi->php2xai_runtime_tensor_data_ptr($this->handle, $id, $len);
+
+		return $this->wrapView($ptr, (int)$len[0], "getTensorData", $id);
+	}
+
+	public function getTensorGradView(int $id) : ?CData
+	{
+		$len = $this->ffi->new("size_t[1]");
+		$ptr = $this->ffi->php2xai_runtime_tensor_grad_ptr($this->handle, $id, $len);
+
+		return $this->wrapView($ptr, (int)$len[0], "getTensorGrad", $id);
+	}
+
+	public function writeTensorData(int $id, array $values, int $offset = 0) : void
+	{
+		$n = count($values);
+		if ($n === 0)
+			return;
 
-		$buf = FFI::new("float[".$n."]");
-		$rc = $this->ffi->php2xai_runtime_get_tensor_data($this->handle, $id, $buf, $n);
+		$buf = $this->packFloats($values);
+
+		$rc = $this->ffi->php2xai_runtime_write_tensor_data($this->handle, $id, $offset, $buf, $n);
 		if ($rc !== 0)
-			throw new RuntimeException("CPP getTensorData failed: ".$rc);
+			throw new RuntimeException("CPP writeTensorData failed: ".$rc);
+	}
 
-		$out = [];
-		for ($i = 0; $i < $n; $i++)
-			$out[] = (float)$buf[$i];
+	public function setTensorData(int $id, array $values) : void
+	{
+		$n = count($values);
+		$buf = $this->packFloats($values);
 
-		return $out;
+		$rc = $this->ffi->php2xai_runtime_set_tensor_data($this->handle, $id, $buf, $n);
+		if ($rc !== 0)
+			throw new RuntimeException("CPP setTensorData failed: ".$rc);
 	}
 
-	public function getTensorGrad(int $id) : array
+	public function setInput(array $x) : void
 	{
-		$n = $this->getTensorSize($id);
-		if ($n === null)
-			throw new RuntimeException("Unknown tensor id: ".$id);
+		$this->setTensorData($this->inputId, array_values($x));
+	}
+
+	public function setTarget(array $y) : void
+	{
+		$this->setTensorData($this->targetId, array_values($y));
+	}
 
-		$buf = FFI::new("float[".$n."]");
-		$rc = $this->ffi->php2xai_runtime_get_tensor_grad($this->handle, $id, $buf, $n);
+	/**
+	 * Same definition as the config "optimizer" key, e.g.
+	 * ['name' => 'Adam', 'params' => ['learningRate' => 0.01]]
+	 */
+	public function setOptimizer(array $optimizerDef) : void
+	{
+		$rc = $this->ffi->php2xai_runtime_set_optimizer($this->handle, json_encode($optimizerDef));
 		if ($rc !== 0)
-			throw new RuntimeException("CPP getTensorGrad failed: ".$rc);
+			throw new RuntimeException("CPP setOptimizer failed: ".$rc);
+	}
 
-		$out = [];
-		for ($i = 0; $i < $n; $i++)
-			$out[] = (float)$buf[$i];
+	/**
+	 * Input, target, forward, backward and optimizer step in one call: returns the batch loss
+	 */
+	public function trainStep(array $x, array $y) : float
+	{
+		$x = array_values($x);
+		$y = array_values($y);
+		$loss = $this->ffi->new("float[1]");
 
-		return $out;
+		$rc = $this->ffi->php2xai_runtime_train_step(
+			$this->handle,
+			$this->packFloats($x),
+			count($x),
+			$this->packFloats($y),
+			count($y),
+			$loss
+		);
+
+		if ($rc !== 0)
+			throw new RuntimeException("CPP trainStep failed: ".$rc);
+
+		return (float)$loss[0];
+	}
+
+	/**
+	 * Per-op wall time, calls, FLOPs and bytes of the native forward/backward
+	 */
+	public function setProfiling(bool $enabled) : void
+	{
+		$rc = $this->ffi->php2xai_runtime_set_profiling($this->handle, $enabled ? 1 : 0);
+		if ($rc !== 0)
+			throw new RuntimeException("CPP setProfiling failed: ".$rc);
+	}
+
+	public function resetProfile() : void
+	{
+		$this->ffi->php2xai_runtime_reset_profile($this->handle);
+	}
+
+	/**
+	 * ['enabled' => bool, 'ops' => [...], 'kernels' => [name => ['forward' => ..., 'backward' => ...]], ...]
+	 */
+	public function getProfile() : array
+	{
+		$json = $this->ffi->php2xai_runtime_get_profile($this->handle);
+		if ($json === null)
+			throw new RuntimeException("CPP getProfile failed");
+
+		return json_decode($json, true);
+	}
+
+	private function packFloats(array $values) : CData
+	{
+		$n = count($values);
+		$buf = FFI::new("float[".max($n, 1)."]");
+
+		if ($n > 0)
+			FFI::memcpy($buf, pack('g*', ...$values), $n * 4);
+
+		return $buf;
+	}
+
+	private function wrapView(?CData $ptr, int $len, string $what, int $id) : ?CData
+	{
+		if ($ptr === null && $len === 0 && isset($this->tensors[$id]))
+			return null;
+
+		if ($ptr === null)
+			throw new RuntimeException("CPP ".$what." failed: ".$id);
+
+		return FFI::cast("float[".$len."]", $ptr);
+	}
+
+	private function copyOut(?CData $view) : array
+	{
+		if ($view === null)
+			return [];
+
+		// One copy: the raw bytes are unpacked straight into the PHP array
+		return array_values(unpack('g*', FFI::string($view, FFI::sizeof($view))));
 	}
 
 	private function getCdef() : string
 	{
 		return <<<CDEF
+			typedef unsigned long size_t;
 			typedef struct PHP2xAI_Runtime PHP2xAI_Runtime;
 			PHP2xAI_Runtime* php2xai_runtime_create(const char* graph_json);
 			void php2xai_runtime_destroy(PHP2xAI_Runtime* runtime);
@@ -127,6 +250,15 @@ class GraphRuntimeCpp extends GraphRuntime
 			int* php2xai_runtime_get_tensor_shape(PHP2xAI_Runtime* runtime, int id);
 			int php2xai_runtime_get_tensor_data(PHP2xAI_Runtime* runtime, int id, float* out, int n);
 			int php2xai_runtime_get_tensor_grad(PHP2xAI_Runtime* runtime, int id, float* out, int n);
+			float* php2xai_runtime_tensor_data_ptr(PHP2xAI_Runtime* runtime, int id, size_t* out_len);
+			float* php2xai_runtime_tensor_grad_ptr(PHP2xAI_Runtime* runtime, int id, size_t* out_len);
+			int php2xai_runtime_write_tensor_data(PHP2xAI_Runtime* runtime, int id, size_t offset, const float* x, size_t n);
+			int php2xai_runtime_set_tensor_data(PHP2xAI_Runtime* runtime, int id, const float* x, size_t n);
+			int php2xai_runtime_set_optimizer(PHP2xAI_Runtime* runtime, const char* optimizer_json);
+			int php2xai_runtime_train_step(PHP2xAI_Runtime* runtime, const float* x, size_t x_len, const float* y, size_t y_len, float* out_loss);
+			int php2xai_runtime_set_profiling(PHP2xAI_Runtime* runtime, int enabled);
+			int php2xai_runtime_reset_profile(PHP2xAI_Runtime* runtime);
+			const char* php2xai_runtime_get_profile(PHP2xAI_Runtime* runtime);
 		CDEF;
 	}
 }
@@ -1,8 +1,10 @@
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include "Adam.hpp"
 #include "../Core/runtime.hpp"
+#include "../Utility/state_stream.hpp"
 
 namespace PHP2xAI::Runtime::CPP::Optimizers
 {
@@ -63,4 +65,40 @@ namespace PHP2xAI::Runtime::CPP::Optimizers
 
 		++stepNumber_;
 	}
+
+	void Adam::saveState(StateWriter& out) const
+	{
+		out.u64(stepNumber_);
+
+		// Sorted ids: the same state always produces the same bytes
+		std::vector<int> ids;
+		ids.reserve(mp_.size());
+		for (const auto& entry : mp_)
+			ids.push_back(entry.first);
+		std::sort(ids.begin(), ids.end());
+
+		out.u64(ids.size());
+		for (int id : ids)
+		{
+			out.u64(static_cast<uint64_t>(id));
+			out.vector(mp_.at(id));
+			out.vector(vp_.at(id));
+		}
+	}
+
+	void Adam::loadState(StateReader& in)
+	{
+		stepNumber_ = static_cast<std::size_t>(in.u64());
+
+		mp_.clear();
+		vp_.clear();
+
+		const auto count = in.u64();
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			const auto id = static_cast<int>(in.u64());
+			mp_[id] = in.vector<Scalar>();
+			vp_[id] = in.vector<Scalar>();
+		}
+	}
 }
@@ -17,6 +17,8 @@ namespace PHP2xAI::Runtime::CPP::Optimizers
 					Scalar eps = 0.00000001f);
 
 		void step(GraphRuntime& graph) override;
+		void saveState(StateWriter& out) const override;
+		void loadState(StateReader& in) override;
 
 	private:
 		Scalar learningRate_;
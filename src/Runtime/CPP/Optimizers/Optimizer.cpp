@@ -1,5 +1,6 @@
 #include "Optimizer.hpp"
 #include "../Core/runtime.hpp"
+#include "../Utility/state_stream.hpp"
 
 namespace PHP2xAI::Runtime::CPP::Optimizers
 {
@@ -16,6 +17,14 @@ namespace PHP2xAI::Runtime::CPP::Optimizers
 		gradClip_ = clip;
 	}
 
+	void Optimizer::saveState(StateWriter& /*out*/) const
+	{
+	}
+
+	void Optimizer::loadState(StateReader& /*in*/)
+	{
+	}
+
 	// void Optimizer::addError(Scalar error)
 	// {
 	// 	error_ += error;
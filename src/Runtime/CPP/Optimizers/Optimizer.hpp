@@ -6,6 +6,8 @@
 namespace PHP2xAI::Runtime::CPP
 {
 	class GraphRuntime;
+	class StateWriter;
+	class StateReader;
 }
 
 #include "../types.hpp"
@@ -18,6 +20,9 @@ namespace PHP2xAI::Runtime::CPP::Optimizers
 		virtual ~Optimizer() = default;
 
 		virtual void step(GraphRuntime& graph) = 0;
+		// Resumable state (moments, step counter); stateless optimizers write nothing
+		virtual void saveState(StateWriter& out) const;
+		virtual void loadState(StateReader& in);
 		// Scalar getError() const;
 		void setGradClip(std::optional<Scalar> clip);
 		// void addError(Scalar error);
@@ -0,0 +1,137 @@
+<?php
+
+namespace PHP2xAI\Runtime\CPP;
+
+use FFI;
+use RuntimeException;
+
+/**
+ * Producer side of the shared-memory batch ring read by the CPP trainer
+ * (config key "train_ring"). Each push() is one packed batch, endEpoch()
+ * closes the current epoch and close() ends the stream.
+ */
+class ShmRingFFI
+{
+	private FFI $ffi;
+	private $handle;
+	private string $name;
+	private int $slotFloats;
+
+	public function __construct(string $name, int $slots, int $slotFloats, ?string $soPath = null)
+	{
+		if (!extension_loaded('ffi'))
+			throw new RuntimeException("FFI extension is not enabled");
+
+		$soPath = $soPath ?? realpath(__DIR__ . '/php2xai_runtime.so');
+
+		if (!is_string($soPath) || !is_file($soPath))
+			throw new RuntimeException("FFI library not found: ".$soPath);
+
+		$this->ffi = FFI::cdef($this->getCdef(), $soPath);
+		$this->handle = $this->ffi->php2xai_ring_create($name, $slots, $slotFloats);
+
+		if ($this->handle === null)
+			throw new RuntimeException("Unable to create shared ring: ".$name);
+
+		$this->name = $name;
+		$this->slotFloats = $slotFloats;
+	}
+
+	public function __destruct()
+	{
+		if (isset($this->handle) && $this->handle !== null)
+		{
+			$this->ffi->php2xai_ring_destroy($this->handle);
+			$this->handle = null;
+		}
+	}
+
+	public function getName() : string
+	{
+		return $this->name;
+	}
+
+	/**
+	 * Push one batch: $x and $y are flat arrays or arrays of rows.
+	 * Returns false if the ring stayed full for $timeoutMs (-1 waits forever).
+	 */
+	public function push(array $x, array $y, int $timeoutMs = -1) : bool
+	{
+		$xValues = $this->flatten($x);
+		$yValues = $this->flatten($y);
+		$xLen = count($xValues);
+		$yLen = count($yValues);
+
+		if ($xLen + $yLen > $this->slotFloats)
+			throw new RuntimeException("Batch does not fit in a ring slot");
+
+		$xBuffer = $this->toFloatBuffer($xValues);
+		$yBuffer = $this->toFloatBuffer($yValues);
+
+		$rc = $this->ffi->php2xai_ring_push($this->handle, $xBuffer, $xLen, $yBuffer, $yLen, $timeoutMs);
+
+		if ($rc === 2)
+			return false;
+
+		if ($rc !== 0)
+			throw new RuntimeException("Shared ring push failed: ".$rc);
+
+		return true;
+	}
+
+	public function endEpoch(int $timeoutMs = -1) : bool
+	{
+		$rc = $this->ffi->php2xai_ring_end_epoch($this->handle, $timeoutMs);
+
+		if ($rc === 2)
+			return false;
+
+		if ($rc !== 0)
+			throw new RuntimeException("Shared ring end epoch failed: ".$rc);
+
+		return true;
+	}
+
+	public function close() : void
+	{
+		$this->ffi->php2xai_ring_close($this->handle);
+	}
+
+	private function flatten(array $values) : array
+	{
+		$flat = [];
+
+		array_walk_recursive($values, function ($v) use (&$flat) {
+			$flat[] = (float)$v;
+		});
+
+		return $flat;
+	}
+
+	private function toFloatBuffer(array $values)
+	{
+		$count = count($values);
+
+		if ($count === 0)
+			return null;
+
+		// pack('g*') already yields little-endian floats: one copy into FFI memory
+		$buffer = FFI::new("float[".$count."]");
+		FFI::memcpy($buffer, pack('g*', ...$values), $count * 4);
+
+		return $buffer;
+	}
+
+	private function getCdef() : string
+	{
+		return <<<CDEF
+			typedef unsigned long size_t;
+			typedef struct PHP2xAI_Ring PHP2xAI_Ring;
+			PHP2xAI_Ring* php2xai_ring_create(const char* name, size_t slots, size_t slot_floats);
+			void php2xai_ring_destroy(PHP2xAI_Ring* ring);
+			int php2xai_ring_push(PHP2xAI_Ring* ring, const float* x, size_t x_len, const float* y, size_t y_len, int timeout_ms);
+			int php2xai_ring_end_epoch(PHP2xAI_Ring* ring, int timeout_ms);
+			int php2xai_ring_close(PHP2xAI_Ring* ring);
+		CDEF;
+	}
+}
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
 #include "Utility.hpp"
 
 namespace PHP2xAI::Runtime::CPP
@@ -21,4 +25,67 @@ namespace PHP2xAI::Runtime::CPP
 
 		return maxIndex;
 	}
+
+	std::size_t Utility::topK(const Scalar *values, std::size_t n, std::size_t k, bool softmax, int *ids, Scalar *scores)
+	{
+		k = std::min(k, n);
+		if (k == 0)
+			return 0;
+
+		using Entry = std::pair<Scalar, int>;
+		const auto better = [](const Entry &a, const Entry &b)
+		{
+			return a.first > b.first || (a.first == b.first && a.second < b.second);
+		};
+
+		// Heap of the k best so far with the worst on top, and an online softmax normalizer:
+		// one pass over the row, nothing of size n allocated
+		std::vector<Entry> heap;
+		heap.reserve(k);
+
+		Scalar maxValue = values[0];
+		Scalar sum = 0.0f;
+
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			const auto v = values[i];
+
+			if (softmax)
+			{
+				if (v > maxValue)
+				{
+					sum = sum * std::exp(maxValue - v) + 1.0f;
+					maxValue = v;
+				}
+				else
+				{
+					sum += std::exp(v - maxValue);
+				}
+			}
+
+			const Entry entry(v, static_cast<int>(i));
+
+			if (heap.size() < k)
+			{
+				heap.push_back(entry);
+				std::push_heap(heap.begin(), heap.end(), better);
+			}
+			else if (better(entry, heap.front()))
+			{
+				std::pop_heap(heap.begin(), heap.end(), better);
+				heap.back() = entry;
+				std::push_heap(heap.begin(), heap.end(), better);
+			}
+		}
+
+		std::sort_heap(heap.begin(), heap.end(), better);
+
+		for (std::size_t i = 0; i < k; ++i)
+		{
+			ids[i] = heap[i].second;
+			scores[i] = softmax ? std::exp(heap[i].first - maxValue) / sum : heap[i].first;
+		}
+
+		return k;
+	}
 }
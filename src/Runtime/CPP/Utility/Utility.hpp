@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 #include "../types.hpp"
 
@@ -9,5 +10,8 @@ namespace PHP2xAI::Runtime::CPP
 	{
 	public:
 		static int argmax(const std::vector<Scalar> &values);
+		// k largest of values[0, n), best first (ties: lower id first), returns min(k, n). With
+		// softmax the scores are probabilities normalized over all n values, else the raw values
+		static std::size_t topK(const Scalar *values, std::size_t n, std::size_t k, bool softmax, int *ids, Scalar *scores);
 	};
 }
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace PHP2xAI::Runtime::CPP
+{
+	// Binary encoder (host byte order) for resumable training state: optimizer, dataset position.
+	// Appends to a caller-owned buffer so the bytes can be handed to CheckpointWriter as is.
+	class StateWriter
+	{
+	public:
+		explicit StateWriter(std::string &out)
+			: out_(out)
+		{
+		}
+
+		void u64(uint64_t value)
+		{
+			raw(&value, sizeof(value));
+		}
+
+		void f32(float value)
+		{
+			raw(&value, sizeof(value));
+		}
+
+		void raw(const void *data, std::size_t bytes)
+		{
+			out_.append(static_cast<const char *>(data), bytes);
+		}
+
+		template <typename T>
+		void vector(const std::vector<T> &values)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "state vectors must be trivially copyable");
+
+			u64(values.size());
+			raw(values.data(), values.size() * sizeof(T));
+		}
+
+		void string(const std::string &value)
+		{
+			u64(value.size());
+			raw(value.data(), value.size());
+		}
+
+		// The standard text form is the only portable serialization of the engine state
+		void rng(const std::mt19937 &engine)
+		{
+			std::ostringstream text;
+			text << engine;
+			string(text.str());
+		}
+
+	private:
+		std::string &out_;
+	};
+
+	class StateReader
+	{
+	public:
+		StateReader(const char *data, std::size_t size)
+			: cur_(data), end_(data + size)
+		{
+		}
+
+		uint64_t u64()
+		{
+			uint64_t value;
+			raw(&value, sizeof(value));
+			return value;
+		}
+
+		float f32()
+		{
+			float value;
+			raw(&value, sizeof(value));
+			return value;
+		}
+
+		void raw(void *data, std::size_t bytes)
+		{
+			if (static_cast<std::size_t>(end_ - cur_) < bytes)
+				throw std::runtime_error("Truncated training state");
+
+			std::memcpy(data, cur_, bytes);
+			cur_ += bytes;
+		}
+
+		template <typename T>
+		std::vector<T> vector()
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "state vectors must be trivially copyable");
+
+			const auto count = u64();
+			if (count > static_cast<std::size_t>(end_ - cur_) / sizeof(T))
+				throw std::runtime_error("Truncated training state");
+
+			std::vector<T> values(count);
+			raw(values.data(), count * sizeof(T));
+			return values;
+		}
+
+		std::string string()
+		{
+			const auto size = u64();
+			if (size > static_cast<std::size_t>(end_ - cur_))
+				throw std::runtime_error("Truncated training state");
+
+			std::string value(cur_, size);
+			cur_ += size;
+			return value;
+		}
+
+		void rng(std::mt19937 &engine)
+		{
+			std::istringstream text(string());
+			text >> engine;
+
+			if (!text)
+				throw std::runtime_error("Invalid random engine state");
+		}
+
+		bool atEnd() const
+		{
+			return cur_ == end_;
+		}
+
+	private:
+		const char *cur_;
+		const char *end_;
+	};
+}
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Core/runtime.hpp"
+
+// Kernel microbenchmark: every GraphRuntime kernel over a sweep of shapes, forward and backward.
+// Each case is a one-op graph; times come from the op profiler, so graph bookkeeping (gradient
+// reset, loss gradient) stays out of the numbers. GFLOP/s and GB/s use the profiler's estimates.
+// Build once per backend and diff the --json output:
+//
+// g++ -std=c++17 -O3 -DNDEBUG -march=native -DPHP2XAI_USE_EIGEN=0 -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/runtime.cpp Core/json_loader.cpp Core/op_profiler.cpp Core/weights_file.cpp Core/model_bundle.cpp kernel_bench.cpp -o kernel_bench
+// g++ -std=c++17 -O3 -DNDEBUG -march=native -DPHP2XAI_USE_EIGEN -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/runtime.cpp Core/json_loader.cpp Core/op_profiler.cpp Core/weights_file.cpp Core/model_bundle.cpp kernel_bench.cpp -o kernel_bench_eigen
+//
+// ./kernel_bench [--json results.json] [--filter MATMUL] [--min-time 0.25] [--quick]
+
+using PHP2xAI::Runtime::CPP::GraphRuntime;
+using PHP2xAI::Runtime::CPP::OpProfiler;
+using PHP2xAI::Runtime::CPP::json;
+
+namespace
+{
+	struct Case
+	{
+		std::string op;
+		std::string kernel;
+		// First input is the graph input, the second (if any) a param or the integer target
+		std::vector<std::vector<int>> inputs;
+		std::vector<int> output;
+		std::vector<int> axes{};
+		bool quick = true;
+	};
+
+	struct Result
+	{
+		const Case *bench;
+		bool backward;
+		OpProfiler::Counters counters;
+	};
+
+	std::vector<Case> cases()
+	{
+		return {
+			{"matmul", "MATMUL_2D_2D", {{64, 784}, {784, 128}}, {64, 128}},
+			{"matmul", "MATMUL_2D_2D", {{128, 512}, {512, 512}}, {128, 512}},
+			{"matmul", "MATMUL_2D_2D", {{256, 1024}, {1024, 1024}}, {256, 1024}, {}, false},
+			{"matmul", "MATMUL_1B_2D_2D", {{32, 64, 64}, {32, 64, 64}}, {32, 64, 64}},
+			{"matmul", "MATMUL_1B_2D_2D", {{16, 128, 256}, {16, 256, 256}}, {16, 128, 256}, {}, false},
+			{"matmul", "MATMUL_1B_2D_2D_LINEAR", {{32, 64, 256}, {256, 256}}, {32, 64, 256}},
+			{"matmul", "MATMUL_1B_2D_2D_LINEAR", {{16, 128, 512}, {512, 2048}}, {16, 128, 2048}, {}, false},
+			{"matmul", "MATMUL_2B_2D_2D", {{8, 8, 64, 64}, {8, 8, 64, 64}}, {8, 8, 64, 64}},
+			{"matmul", "MATMUL_2B_2D_2D", {{4, 12, 128, 64}, {4, 12, 64, 128}}, {4, 12, 128, 128}, {}, false},
+			{"matmul", "MATMUL_GENERIC_B_2D_2D_BROADCAST", {{32, 64, 128}, {128, 128}}, {32, 64, 128}},
+			{"add", "ADD_1D_LAST", {{65536}, {65536}}, {65536}},
+			{"add", "ADD_2D_LAST", {{256, 1024}, {1024}}, {256, 1024}},
+			{"add", "ADD_3D_LAST", {{32, 128, 512}, {512}}, {32, 128, 512}},
+			{"add", "ADD_GENERIC_LAST", {{8, 8, 64, 64}, {64}}, {8, 8, 64, 64}},
+			{"softmax", "SOFTMAX_1D_LAST", {{4096}}, {4096}},
+			{"softmax", "SOFTMAX_2D_LAST", {{256, 1000}}, {256, 1000}},
+			{"softmax", "SOFTMAX_3D_LAST", {{32, 128, 128}}, {32, 128, 128}},
+			{"softmax", "SOFTMAX_GENERIC_AXIS", {{32, 128, 128}}, {32, 128, 128}, {1}},
+			{"softmax_ce_logits_label_int", "CE_LOGITS_LABEL_INT_1D_LAST", {{1000}, {}}, {}},
+			{"softmax_ce_logits_label_int", "CE_LOGITS_LABEL_INT_2D_LAST", {{256, 1000}, {256}}, {256}},
+			{"softmax_ce_logits_label_int", "CE_LOGITS_LABEL_INT_3D_LAST", {{32, 128, 512}, {32, 128}}, {32, 128}},
+			{"softmax_ce_logits_label_int", "CE_LOGITS_LABEL_INT_GENERIC_AXIS", {{32, 128, 512}, {32, 128}}, {32, 128}, {-1}},
+			{"mean", "MEAN_1D_FIRST", {{65536}}, {}},
+			{"mean", "MEAN_2D_FIRST", {{256, 1024}}, {1024}},
+			{"mean", "MEAN_3D_FIRST", {{32, 128, 512}}, {128, 512}},
+			{"mean", "MEAN_GENERIC_AXIS", {{32, 128, 512}}, {32, 512}, {1}}
+		};
+	}
+
+	std::string shapeText(const std::vector<int> &shape)
+	{
+		std::string text = "[";
+		for (std::size_t i = 0; i < shape.size(); ++i)
+			text += (i > 0 ? "," : "") + std::to_string(shape[i]);
+		return text + "]";
+	}
+
+	std::string shapesText(const Case &bench)
+	{
+		std::string text;
+		for (std::size_t i = 0; i < bench.inputs.size(); ++i)
+			text += (i > 0 ? "x" : "") + shapeText(bench.inputs[i]);
+		return text;
+	}
+
+	// x (input), y (target), optional param, out (also the loss, so backward starts from it)
+	GraphRuntime buildGraph(const Case &bench)
+	{
+		const bool labels = bench.op == "softmax_ce_logits_label_int";
+		const bool binary = bench.inputs.size() > 1 && !labels;
+
+		json tensors = json::array();
+		tensors.push_back({{"id", 0}, {"kind", "input"}, {"name", "x"}, {"shape", bench.inputs[0]}});
+		tensors.push_back({{"id", 1}, {"kind", "target"}, {"name", "y"}, {"shape", labels ? bench.inputs[1] : std::vector<int>{1}}});
+		tensors.push_back({{"id", 2}, {"kind", "param"}, {"name", "w"}, {"shape", binary ? bench.inputs[1] : std::vector<int>{1}}});
+		tensors.push_back({{"id", 3}, {"kind", "intermediate"}, {"name", "out"}, {"shape", bench.output}});
+
+		json op = {
+			{"id", 0},
+			{"op", bench.op},
+			{"inputs", binary ? json{0, 2} : (labels ? json{0, 1} : json{0})},
+			{"output", 3},
+			{"attributes", {{"kernel", bench.kernel}, {"axes", bench.axes}}}
+		};
+
+		json graphDef = {
+			{"tensors", tensors},
+			{"ops", json::array({op})},
+			{"loss", 3},
+			{"output", 3},
+			{"trainable", binary ? json{2} : json::array()}
+		};
+
+		GraphRuntime graph(graphDef);
+
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> values(-1.0f, 1.0f);
+
+		for (int id : {0, 2})
+		{
+			for (auto &v : graph.tensors[id].data)
+				v = values(rng);
+		}
+
+		return graph;
+	}
+
+	void run(const Case &bench, double minTime, std::vector<Result> &results)
+	{
+		auto graph = buildGraph(bench);
+
+		// Warm up caches and the allocator before anything is counted
+		for (int i = 0; i < 2; ++i)
+		{
+			graph.forward();
+			graph.backward();
+		}
+
+		graph.setProfiling(true);
+
+		const auto &entry = graph.profile()->entries().at(0);
+
+		while (entry.forward.calls < 3 || entry.forward.seconds + entry.backward.seconds < minTime)
+		{
+			graph.forward();
+			graph.backward();
+		}
+
+		results.push_back({&bench, false, entry.forward});
+		results.push_back({&bench, true, entry.backward});
+	}
+
+	json resultJson(const Result &result)
+	{
+		const auto &c = result.counters;
+		const auto perCall = c.calls > 0 ? c.seconds / static_cast<double>(c.calls) : 0.0;
+
+		return {
+			{"op", result.bench->op},
+			{"kernel", result.bench->kernel},
+			{"shapes", result.bench->inputs},
+			{"pass", result.backward ? "backward" : "forward"},
+			{"calls", c.calls},
+			{"us_per_call", perCall * 1e6},
+			{"gflops", c.seconds > 0.0 ? c.flops / c.seconds * 1e-9 : 0.0},
+			{"gbps", c.seconds > 0.0 ? c.bytes / c.seconds * 1e-9 : 0.0}
+		};
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::string jsonPath;
+	std::string filter;
+	double minTime = 0.25;
+	bool quick = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--json" && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (arg == "--filter" && i + 1 < argc)
+			filter = argv[++i];
+		else if (arg == "--min-time" && i + 1 < argc)
+			minTime = std::stod(argv[++i]);
+		else if (arg == "--quick")
+			quick = true;
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--json results.json] [--filter KERNEL] [--min-time seconds] [--quick]\n";
+			return 1;
+		}
+	}
+
+	const auto all = cases();
+	std::vector<Result> results;
+
+	std::printf("%-34s %-28s %-8s %12s %10s %9s\n", "kernel", "shapes", "pass", "us/call", "GFLOP/s", "GB/s");
+
+	try
+	{
+		for (const auto &bench : all)
+		{
+			if ((quick && !bench.quick) || (!filter.empty() && bench.kernel.find(filter) == std::string::npos))
+				continue;
+
+			run(bench, minTime, results);
+
+			for (auto it = results.end() - 2; it != results.end(); ++it)
+			{
+				const auto row = resultJson(*it);
+				std::printf("%-34s %-28s %-8s %12.2f %10.2f %9.2f\n",
+					bench.kernel.c_str(),
+					shapesText(bench).c_str(),
+					it->backward ? "backward" : "forward",
+					row["us_per_call"].get<double>(),
+					row["gflops"].get<double>(),
+					row["gbps"].get<double>());
+				std::fflush(stdout);
+			}
+		}
+	}
+	catch (const std::exception &ex)
+	{
+		std::cerr << "Error: " << ex.what() << "\n";
+		return 1;
+	}
+
+	if (!jsonPath.empty())
+	{
+		json doc = {
+			#if PHP2XAI_USE_EIGEN
+				{"backend", "eigen"},
+			#else
+				{"backend", "naive"},
+			#endif
+			{"compiler", __VERSION__},
+			{"min_time", minTime},
+			{"results", json::array()}
+		};
+
+		for (const auto &result : results)
+			doc["results"].push_back(resultJson(result));
+
+		std::ofstream out(jsonPath, std::ios::trunc);
+		out << doc.dump(1) << "\n";
+
+		if (!out)
+		{
+			std::cerr << "Error: unable to write " << jsonPath << "\n";
+			return 1;
+		}
+	}
+
+	return 0;
+}
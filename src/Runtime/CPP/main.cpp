@@ -1,23 +1,26 @@
+#include <csignal>
 #include <exception>
 #include <iostream>
 #include <string>
 #include "Core/runtime.hpp"
 #include "Core/Core.hpp"
+#include "Core/inference_server.hpp"
 
-// g++ -std=c++17 -I./ -I./ThirdParty Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp Optimizers/Fixed.cpp main.cpp -o php2xai_runtime
+// g++ -std=c++17 -I./ -I./ThirdParty Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Core/json_loader.cpp Core/checkpoint_writer.cpp Core/context_pool.cpp Core/inference_server.cpp Core/op_profiler.cpp Core/trace_recorder.cpp Core/weights_file.cpp Core/model_bundle.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Dataset/token_stream_dataset.cpp Dataset/bucket_file_dataset.cpp Dataset/shm_ring.cpp Dataset/shm_ring_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp Optimizers/Fixed.cpp main.cpp -o php2xai_runtime
 
 // COMPILAZIONE NAIVE
-// g++ -std=c++17 -O3 -DNDEBUG -march=native -flto -pipe -DPHP2XAI_USE_EIGEN=0 -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp Optimizers/Fixed.cpp main.cpp -o php2xai_runtime
+// g++ -std=c++17 -O3 -DNDEBUG -march=native -flto -pipe -DPHP2XAI_USE_EIGEN=0 -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Core/json_loader.cpp Core/checkpoint_writer.cpp Core/context_pool.cpp Core/inference_server.cpp Core/op_profiler.cpp Core/trace_recorder.cpp Core/weights_file.cpp Core/model_bundle.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Dataset/token_stream_dataset.cpp Dataset/bucket_file_dataset.cpp Dataset/shm_ring.cpp Dataset/shm_ring_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp Optimizers/Fixed.cpp main.cpp -o php2xai_runtime
 //.so
-// g++ -std=c++17 -O3 -fPIC -shared -DPHP2XAI_USE_EIGEN=0 -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Core/ffi.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp  Optimizers/Fixed.cpp -o php2xai_runtime.so
+// g++ -std=c++17 -O3 -fPIC -shared -DPHP2XAI_USE_EIGEN=0 -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Core/json_loader.cpp Core/checkpoint_writer.cpp Core/context_pool.cpp Core/inference_server.cpp Core/op_profiler.cpp Core/trace_recorder.cpp Core/weights_file.cpp Core/model_bundle.cpp Core/ffi.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Dataset/token_stream_dataset.cpp Dataset/bucket_file_dataset.cpp Dataset/shm_ring.cpp Dataset/shm_ring_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp  Optimizers/Fixed.cpp -o php2xai_runtime.so
 
 // COMPILAZIONE EIGEN
-// g++ -std=c++17 -O3 -DNDEBUG -march=native -flto -pipe -DPHP2XAI_USE_EIGEN -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp Optimizers/Fixed.cpp main.cpp -o php2xai_runtime_eigen
+// g++ -std=c++17 -O3 -DNDEBUG -march=native -flto -pipe -DPHP2XAI_USE_EIGEN -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Core/json_loader.cpp Core/checkpoint_writer.cpp Core/context_pool.cpp Core/inference_server.cpp Core/op_profiler.cpp Core/trace_recorder.cpp Core/weights_file.cpp Core/model_bundle.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Dataset/token_stream_dataset.cpp Dataset/bucket_file_dataset.cpp Dataset/shm_ring.cpp Dataset/shm_ring_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp Optimizers/Fixed.cpp main.cpp -o php2xai_runtime_eigen
 //.so
-// g++ -std=c++17 -O3 -fPIC -shared -DPHP2XAI_USE_EIGEN -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Core/ffi.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp  Optimizers/Fixed.cpp -o php2xai_runtime_eigen.so
+// g++ -std=c++17 -O3 -fPIC -shared -DPHP2XAI_USE_EIGEN -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Core/json_loader.cpp Core/checkpoint_writer.cpp Core/context_pool.cpp Core/inference_server.cpp Core/op_profiler.cpp Core/trace_recorder.cpp Core/weights_file.cpp Core/model_bundle.cpp Core/ffi.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Dataset/token_stream_dataset.cpp Dataset/bucket_file_dataset.cpp Dataset/shm_ring.cpp Dataset/shm_ring_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp  Optimizers/Fixed.cpp -o php2xai_runtime_eigen.so
 
 
 // ./php2xai_runtime ../../../Exercises/MNIST/config.json
+// ./php2xai_runtime --serve server.json     (inference daemon, see Core/inference_server.hpp)
 
 // Runtime/
 // └── CPP/
@@ -37,16 +40,42 @@
 //     │
 //     └── php2xai_runtime       ← binary output
 
+namespace
+{
+	PHP2xAI::Runtime::CPP::InferenceServer *activeServer = nullptr;
+
+	void stopServer(int)
+	{
+		if (activeServer != nullptr)
+			activeServer->stop();
+	}
+}
+
 int main(int argc, char **argv)
 {
-	if (argc < 2)
+	if (argc < 2 || (std::string(argv[1]) == "--serve" && argc < 3))
 	{
-		std::cerr << "Usage: " << (argc > 0 ? argv[0] : "php2xai_runtime") << " <config.json>\n";
+		const std::string name = argc > 0 ? argv[0] : "php2xai_runtime";
+		std::cerr << "Usage: " << name << " <config.json>\n"
+			<< "       " << name << " --serve <server.json>\n";
 		return 1;
 	}
 
 	try
 	{
+		if (std::string(argv[1]) == "--serve")
+		{
+			auto server = PHP2xAI::Runtime::CPP::InferenceServer::fromConfig(argv[2]);
+
+			activeServer = server.get();
+			std::signal(SIGINT, stopServer);
+			std::signal(SIGTERM, stopServer);
+
+			server->run();
+			activeServer = nullptr;
+			return 0;
+		}
+
 		std::string configPath = argv[1];
 		PHP2xAI::Runtime::CPP::Core model(configPath);
 		model.train();
@@ -1,12 +1,121 @@
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 
 #include "Dataset/stream_file_dataset.hpp"
 
+// Regressione del tailing: l'ultima riga senza '\n' esce dall'indice al refresh e il suo
+// batch non deve restare nell'ordine dell'epoca (con e senza cache)
+static int tailCheck() {
+    const std::string path = "/tmp/php2xai_tail_check.txt";
+
+    for (bool cached : {false, true}) {
+        {
+            std::ofstream out(path, std::ios::trunc);
+            out << "1 2|0\n3 4|1\n5 6|0";
+        }
+
+        PHP2xAI::Runtime::CPP::StreamFileDataset ds(path, 2, '|', 42);
+        if (cached) {
+            ds.enableCache(1 << 20);
+        }
+        ds.enableTailing();
+
+        std::vector<float> x, y;
+        std::size_t rows = 0;
+
+        // Due epoche: la seconda legge dalla cache
+        for (int epoch = 0; epoch < 2; ++epoch) {
+            ds.shuffleEpoch();
+            rows = 0;
+            while (ds.nextBatch()) {
+                ds.pack(x, y);
+                rows += y.size();
+            }
+            if (ds.numBatches() != 1 || rows != 2) {
+                std::cerr << "tail check failed (cache=" << cached << "): "
+                          << ds.numBatches() << " batches, " << rows << " rows\n";
+                return 1;
+            }
+        }
+
+        // La riga completata entra nell'epoca successiva
+        {
+            std::ofstream out(path, std::ios::app);
+            out << "\n";
+        }
+        ds.shuffleEpoch();
+        rows = 0;
+        while (ds.nextBatch()) {
+            ds.pack(x, y);
+            rows += y.size();
+        }
+        if (ds.numBatches() != 2 || rows != 3) {
+            std::cerr << "tail check failed after append (cache=" << cached << "): "
+                      << ds.numBatches() << " batches, " << rows << " rows\n";
+            return 1;
+        }
+    }
+
+    std::remove(path.c_str());
+    std::cout << "tail check OK\n";
+    return 0;
+}
+
+// La cache codifica ogni colonna a parte: una colonna float non allarga le colonne intere
+// e la seconda epoca (dalla cache) restituisce gli stessi valori della prima (dal file)
+static int cacheCheck() {
+    const std::string path = "/tmp/php2xai_cache_check.txt";
+
+    {
+        std::ofstream out(path, std::ios::trunc);
+        out << "3 0.25 300|1\n7 -1.5 4000|0\n0 2.75 65535|1\n255 0.5 12|0\n";
+    }
+
+    PHP2xAI::Runtime::CPP::StreamFileDataset ds(path, 4, '|', 42);
+    ds.enableCache(1 << 20);
+
+    std::vector<float> x, y, firstX, firstY;
+
+    for (int epoch = 0; epoch < 2; ++epoch) {
+        ds.resetEpoch();
+        if (!ds.nextBatch()) {
+            std::cerr << "cache check failed: no batch\n";
+            return 1;
+        }
+        ds.pack(x, y);
+        if (epoch == 0) {
+            firstX = x;
+            firstY = y;
+        }
+    }
+
+    // x: uint8 + float + uint16 per 4 righe, y: uint8
+    const std::size_t expected = 4 * (1 + 4 + 2) + 4 * 1;
+    if (x != firstX || y != firstY || ds.cachedBytes() != expected) {
+        std::cerr << "cache check failed: " << ds.cachedBytes() << " bytes cached, expected " << expected << "\n";
+        return 1;
+    }
+
+    std::remove(path.c_str());
+    std::cout << "cache check OK\n";
+    return 0;
+}
+
 int main(int argc, char** argv) {
     try {
-        // uso: ./test_ds train.txt 32 [--sample]
+        if (argc >= 2 && std::string(argv[1]) == "--tail-check") {
+            return tailCheck();
+        }
+        if (argc >= 2 && std::string(argv[1]) == "--cache-check") {
+            return cacheCheck();
+        }
+
+        // uso: ./test_ds train.txt 32 [--sample]   (anche glob: "train-*.txt")
+        //      ./test_ds --tail-check
+        //      ./test_ds --cache-check
         std::string path = (argc >= 2) ? argv[1] : "train.txt";
         std::size_t batchSize = (argc >= 3) ? static_cast<std::size_t>(std::stoul(argv[2])) : 32;
         bool sampleMode = false;
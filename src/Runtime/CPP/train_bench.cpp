@@ -0,0 +1,582 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "Core/Core.hpp"
+#include "Core/runtime.hpp"
+#include "Dataset/Datasets.hpp"
+
+// End-to-end benchmark: builds synthetic MLP, sequence and attention graphs with matching x|y
+// datasets (all generated locally, nothing downloaded), then for each one runs N training steps the
+// way Core::train() does (next batch, pack, forward, backward, optimizer step) and N single-sample
+// predictions the way Core::predict() does. Reports samples/s, p50/p99 step and predict latency,
+// and peak RSS. Every model runs in its own process, so its peak RSS is its own.
+//
+// g++ -std=c++17 -O3 -DNDEBUG -march=native -DPHP2XAI_USE_EIGEN=0 -I./ -I./ThirdParty/nlohmann -I./ThirdParty/eigen Utility/Utility.cpp Core/Core.cpp Core/runtime.cpp Core/json_loader.cpp Core/checkpoint_writer.cpp Core/context_pool.cpp Core/op_profiler.cpp Core/trace_recorder.cpp Core/weights_file.cpp Core/model_bundle.cpp Dataset/TrainValidateDataset.cpp Dataset/stream_file_dataset.cpp Dataset/token_stream_dataset.cpp Dataset/bucket_file_dataset.cpp Dataset/shm_ring.cpp Dataset/shm_ring_dataset.cpp Optimizers/Optimizer.cpp Optimizers/Adam.cpp Optimizers/Fixed.cpp train_bench.cpp -o train_bench
+//
+// ./train_bench [--model mlp|sequence|attention] [--steps 200] [--warmup 10] [--predict 1000]
+//               [--samples 4096] [--dir /tmp/php2xai_bench] [--json results.json]
+
+using namespace PHP2xAI::Runtime::CPP;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct Options
+	{
+		std::string model;
+		std::string dir = "/tmp/php2xai_bench";
+		std::string jsonPath;
+		std::size_t steps = 200;
+		std::size_t warmup = 10;
+		std::size_t predictCalls = 1000;
+		std::size_t samples = 4096;
+	};
+
+	struct Model
+	{
+		std::string name;
+		json graph;
+		std::size_t batchSize = 32;
+		bool variableLength = false;
+		// Writes the x|y training file
+		void (*writeData)(const std::string &path, std::size_t samples, std::mt19937 &rng);
+	};
+
+	// Graph JSON helpers: tensors without "data" start at zero, params are initialized afterwards
+	json tensor(int id, const char *kind, const char *name, std::vector<int> shape)
+	{
+		return {{"id", id}, {"kind", kind}, {"name", name}, {"shape", shape}};
+	}
+
+	json op(int id, const char *name, std::vector<int> inputs, int output, const char *kernel, std::vector<int> axes = {})
+	{
+		json def = {{"id", id}, {"op", name}, {"inputs", inputs}, {"output", output}, {"attributes", {{"kernel", kernel}}}};
+		if (!axes.empty())
+			def["attributes"]["axes"] = axes;
+		return def;
+	}
+
+	// Labels any of the graphs can learn: argmax of a fixed random projection of the features
+	int projectLabel(const float *x, std::size_t dim, std::size_t classes, std::mt19937::result_type seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> weight(-1.0f, 1.0f);
+
+		int best = 0;
+		float bestScore = -1e30f;
+
+		for (std::size_t c = 0; c < classes; ++c)
+		{
+			float score = 0.0f;
+			for (std::size_t d = 0; d < dim; ++d)
+				score += x[d] * weight(rng);
+
+			if (score > bestScore)
+			{
+				bestScore = score;
+				best = static_cast<int>(c);
+			}
+		}
+
+		return best;
+	}
+
+	void writeLine(std::ofstream &out, const std::vector<float> &x, const std::vector<int> &y)
+	{
+		char value[32];
+
+		for (std::size_t i = 0; i < x.size(); ++i)
+		{
+			std::snprintf(value, sizeof(value), i > 0 ? " %.4f" : "%.4f", x[i]);
+			out << value;
+		}
+
+		out << " |";
+		for (int label : y)
+			out << ' ' << label;
+		out << '\n';
+	}
+
+	constexpr std::size_t MlpInputs = 64;
+	constexpr std::size_t MlpHidden = 256;
+	constexpr std::size_t MlpClasses = 10;
+
+	constexpr std::size_t SeqFeatures = 16;
+	constexpr std::size_t SeqHidden = 128;
+	constexpr std::size_t SeqClasses = 8;
+	constexpr int SeqMaxLength = 64;
+
+	constexpr std::size_t AttnSteps = 32;
+	constexpr std::size_t AttnDim = 32;
+	constexpr std::size_t AttnClasses = 8;
+
+	void writeMlpData(const std::string &path, std::size_t samples, std::mt19937 &rng)
+	{
+		std::ofstream out(path, std::ios::trunc);
+		std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+		std::vector<float> x(MlpInputs);
+
+		for (std::size_t s = 0; s < samples; ++s)
+		{
+			for (auto &v : x)
+				v = value(rng);
+
+			writeLine(out, x, {projectLabel(x.data(), MlpInputs, MlpClasses, 1)});
+		}
+	}
+
+	void writeSequenceData(const std::string &path, std::size_t samples, std::mt19937 &rng)
+	{
+		std::ofstream out(path, std::ios::trunc);
+		std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+		std::uniform_int_distribution<int> length(8, SeqMaxLength);
+		std::vector<float> x;
+		std::vector<int> y;
+
+		for (std::size_t s = 0; s < samples; ++s)
+		{
+			const auto steps = static_cast<std::size_t>(length(rng));
+			x.resize(steps * SeqFeatures);
+			y.resize(steps);
+
+			for (auto &v : x)
+				v = value(rng);
+			for (std::size_t t = 0; t < steps; ++t)
+				y[t] = projectLabel(x.data() + t * SeqFeatures, SeqFeatures, SeqClasses, 2);
+
+			writeLine(out, x, y);
+		}
+	}
+
+	void writeAttentionData(const std::string &path, std::size_t samples, std::mt19937 &rng)
+	{
+		std::ofstream out(path, std::ios::trunc);
+		std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+		std::vector<float> x(AttnSteps * AttnDim);
+		std::vector<float> context(AttnDim);
+		std::vector<int> y(AttnSteps);
+
+		for (std::size_t s = 0; s < samples; ++s)
+		{
+			for (auto &v : x)
+				v = value(rng);
+
+			// Each label depends on the running mean of the sequence: attention has to look back
+			std::fill(context.begin(), context.end(), 0.0f);
+			for (std::size_t t = 0; t < AttnSteps; ++t)
+			{
+				for (std::size_t d = 0; d < AttnDim; ++d)
+					context[d] += (x[t * AttnDim + d] - context[d]) / static_cast<float>(t + 1);
+
+				y[t] = projectLabel(context.data(), AttnDim, AttnClasses, 3);
+			}
+
+			writeLine(out, x, y);
+		}
+	}
+
+	json mlpGraph(int batch)
+	{
+		const int d = MlpInputs, h = MlpHidden, c = MlpClasses;
+
+		return {
+			{"tensors", {
+				tensor(0, "input", "x", {batch, d}), tensor(1, "target", "y", {batch}),
+				tensor(2, "param", "W1", {d, h}), tensor(3, "param", "b1", {h}),
+				tensor(4, "intermediate", "z1", {batch, h}), tensor(5, "intermediate", "a1", {batch, h}),
+				tensor(6, "intermediate", "h1", {batch, h}), tensor(7, "param", "W2", {h, c}),
+				tensor(8, "param", "b2", {c}), tensor(9, "intermediate", "z2", {batch, c}),
+				tensor(10, "intermediate", "logits", {batch, c}), tensor(11, "intermediate", "ce", {batch}),
+				tensor(12, "loss", "loss", {})
+			}},
+			{"ops", {
+				op(0, "matmul", {0, 2}, 4, "MATMUL_2D_2D"), op(1, "add", {4, 3}, 5, "ADD_2D_LAST"),
+				op(2, "relu", {5}, 6, ""), op(3, "matmul", {6, 7}, 9, "MATMUL_2D_2D"),
+				op(4, "add", {9, 8}, 10, "ADD_2D_LAST"),
+				op(5, "softmax_ce_logits_label_int", {10, 1}, 11, "CE_LOGITS_LABEL_INT_2D_LAST", {-1}),
+				op(6, "mean", {11}, 12, "MEAN_1D_FIRST", {0})
+			}},
+			{"loss", 12}, {"output", 10}, {"trainable", {2, 3, 7, 8}}
+		};
+	}
+
+	json sequenceGraph(int batch)
+	{
+		const int t = SeqMaxLength, d = SeqFeatures, h = SeqHidden, c = SeqClasses;
+
+		return {
+			{"tensors", {
+				tensor(0, "input", "x", {batch, t, d}), tensor(1, "target", "y", {batch, t}),
+				tensor(2, "param", "W1", {d, h}), tensor(3, "param", "b1", {h}),
+				tensor(4, "intermediate", "z1", {batch, t, h}), tensor(5, "intermediate", "a1", {batch, t, h}),
+				tensor(6, "intermediate", "h1", {batch, t, h}), tensor(7, "param", "W2", {h, c}),
+				tensor(8, "param", "b2", {c}), tensor(9, "intermediate", "z2", {batch, t, c}),
+				tensor(10, "intermediate", "logits", {batch, t, c}), tensor(11, "intermediate", "ce", {batch, t}),
+				tensor(12, "intermediate", "ceT", {t}), tensor(13, "loss", "loss", {})
+			}},
+			{"ops", {
+				op(0, "matmul", {0, 2}, 4, "MATMUL_1B_2D_2D_LINEAR"), op(1, "add", {4, 3}, 5, "ADD_3D_LAST"),
+				op(2, "relu", {5}, 6, ""), op(3, "matmul", {6, 7}, 9, "MATMUL_1B_2D_2D_LINEAR"),
+				op(4, "add", {9, 8}, 10, "ADD_3D_LAST"),
+				op(5, "softmax_ce_logits_label_int", {10, 1}, 11, "CE_LOGITS_LABEL_INT_3D_LAST", {-1}),
+				op(6, "mean", {11}, 12, "MEAN_2D_FIRST", {0}), op(7, "mean", {12}, 13, "MEAN_1D_FIRST", {0})
+			}},
+			{"loss", 13}, {"output", 10}, {"trainable", {2, 3, 7, 8}}, {"max_sequence_length", t}
+		};
+	}
+
+	// The op set has no transpose, so keys are a learned [D, T] memory instead of a projection of
+	// x: scores, softmax over T x T and the weighted sum cost the same as in self-attention
+	json attentionGraph(int batch)
+	{
+		const int t = AttnSteps, d = AttnDim, c = AttnClasses;
+
+		return {
+			{"tensors", {
+				tensor(0, "input", "x", {batch, t, d}), tensor(1, "target", "y", {batch, t}),
+				tensor(2, "param", "Wq", {d, d}), tensor(3, "intermediate", "q", {batch, t, d}),
+				tensor(4, "param", "Kt", {d, t}), tensor(5, "intermediate", "scores", {batch, t, t}),
+				tensor(6, "intermediate", "weights", {batch, t, t}), tensor(7, "param", "Wv", {d, d}),
+				tensor(8, "intermediate", "v", {batch, t, d}), tensor(9, "intermediate", "context", {batch, t, d}),
+				tensor(10, "param", "Wo", {d, c}), tensor(11, "intermediate", "z", {batch, t, c}),
+				tensor(12, "param", "bo", {c}), tensor(13, "intermediate", "logits", {batch, t, c}),
+				tensor(14, "intermediate", "ce", {batch, t}), tensor(15, "intermediate", "ceT", {t}),
+				tensor(16, "loss", "loss", {})
+			}},
+			{"ops", {
+				op(0, "matmul", {0, 2}, 3, "MATMUL_1B_2D_2D_LINEAR"),
+				op(1, "matmul", {3, 4}, 5, "MATMUL_GENERIC_B_2D_2D_BROADCAST"),
+				op(2, "softmax", {5}, 6, "SOFTMAX_3D_LAST", {-1}),
+				op(3, "matmul", {0, 7}, 8, "MATMUL_1B_2D_2D_LINEAR"),
+				op(4, "matmul", {6, 8}, 9, "MATMUL_1B_2D_2D"),
+				op(5, "matmul", {9, 10}, 11, "MATMUL_1B_2D_2D_LINEAR"),
+				op(6, "add", {11, 12}, 13, "ADD_3D_LAST"),
+				op(7, "softmax_ce_logits_label_int", {13, 1}, 14, "CE_LOGITS_LABEL_INT_3D_LAST", {-1}),
+				op(8, "mean", {14}, 15, "MEAN_2D_FIRST", {0}), op(9, "mean", {15}, 16, "MEAN_1D_FIRST", {0})
+			}},
+			{"loss", 16}, {"output", 13}, {"trainable", {2, 4, 7, 10, 12}}
+		};
+	}
+
+	std::vector<Model> models()
+	{
+		return {
+			{"mlp", mlpGraph(64), 64, false, writeMlpData},
+			{"sequence", sequenceGraph(32), 32, true, writeSequenceData},
+			{"attention", attentionGraph(32), 32, false, writeAttentionData}
+		};
+	}
+
+	void initParams(GraphRuntime &graph, std::mt19937 &rng)
+	{
+		for (int id : graph.trainable)
+		{
+			auto &param = graph.tensors[static_cast<std::size_t>(id)];
+			const auto fanIn = param.shape.size() > 1 ? param.shape[0] : 1;
+			std::normal_distribution<float> value(0.0f, 1.0f / std::sqrt(static_cast<float>(fanIn)));
+
+			for (auto &v : param.data)
+				v = param.shape.size() > 1 ? value(rng) : 0.0f;
+		}
+	}
+
+	double percentile(std::vector<double> values, double p)
+	{
+		if (values.empty())
+			return 0.0;
+
+		std::sort(values.begin(), values.end());
+		const auto rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(values.size())));
+		return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+	}
+
+	double elapsed(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	json benchModel(const Model &model, const Options &options)
+	{
+		std::mt19937 rng(1234);
+
+		const auto dataPath = options.dir + "/" + model.name + "-train.txt";
+		model.writeData(dataPath, options.samples, rng);
+
+		GraphRuntime graph(model.graph);
+		initParams(graph, rng);
+
+		std::size_t params = 0;
+		for (const auto *tensor : graph.trainableTensors())
+			params += tensor->data.size();
+
+		std::unique_ptr<Dataset> dataset;
+		if (model.variableLength)
+			dataset = std::make_unique<BucketFileDataset>(std::vector<std::string>{dataPath}, model.batchSize);
+		else
+			dataset = std::make_unique<StreamFileDataset>(dataPath, model.batchSize);
+
+		auto optimizer = Core::createOptimizer({{"name", "Adam"}, {"params", {{"learningRate", 0.001}}}});
+
+		std::vector<Scalar> x;
+		std::vector<Scalar> y;
+		std::vector<double> stepSeconds;
+		std::size_t trainedSamples = 0;
+		double trainSeconds = 0.0;
+		Scalar firstLoss = 0.0f;
+		Scalar lastLoss = 0.0f;
+
+		dataset->shuffleEpoch();
+
+		// Timed as Core::train() spends it: reading the batch is part of the step
+		for (std::size_t step = 0; step < options.warmup + options.steps; ++step)
+		{
+			const auto start = Clock::now();
+
+			if (!dataset->nextBatch())
+			{
+				dataset->shuffleEpoch();
+				if (!dataset->nextBatch())
+					throw std::runtime_error("Dataset has no batches");
+			}
+
+			dataset->pack(x, y);
+			if (const int steps = dataset->sequenceLength(); steps > 0)
+				graph.setSequenceLength(steps);
+
+			graph.swapInput(x);
+			graph.swapTarget(y);
+
+			const auto loss = Core::trainStep(graph, *optimizer);
+			const auto seconds = elapsed(start);
+
+			if (step < options.warmup)
+				continue;
+
+			if (step == options.warmup)
+				firstLoss = loss;
+			lastLoss = loss;
+
+			stepSeconds.push_back(seconds);
+			trainSeconds += seconds;
+			trainedSamples += static_cast<std::size_t>(graph.getBatchSize());
+		}
+
+		// Inference on a forward-only context, as Core::predict() runs it
+		auto context = graph.createContext();
+		if (context->getMaxSequenceLength() > 0)
+			context->setSequenceLength(context->getMaxSequenceLength());
+
+		const auto inSize = context->sampleSize(context->inputId);
+		const auto outSize = context->sampleSize(context->outputId);
+		const auto maxRows = static_cast<std::size_t>(context->getMaxBatchSize());
+
+		std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+		std::vector<Scalar> sample(inSize * maxRows);
+		for (auto &v : sample)
+			v = value(rng);
+
+		std::vector<Scalar> out(outSize * maxRows);
+		std::vector<double> predictSeconds;
+
+		for (std::size_t call = 0; call < options.predictCalls; ++call)
+		{
+			const auto start = Clock::now();
+			Core::predictBatch(*context, sample.data(), 1, out.data());
+			predictSeconds.push_back(elapsed(start));
+		}
+
+		// Full batches: the best case for a batching server
+		const auto batchCalls = std::max<std::size_t>(1, options.predictCalls / 10);
+		const auto batchStart = Clock::now();
+		for (std::size_t call = 0; call < batchCalls; ++call)
+			Core::predictBatch(*context, sample.data(), maxRows, out.data());
+		const auto batchSeconds = elapsed(batchStart);
+
+		struct rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+
+		return {
+			{"model", model.name},
+			{"params", params},
+			{"batch_size", model.batchSize},
+			{"steps", options.steps},
+			{"train_samples_per_sec", trainSeconds > 0.0 ? static_cast<double>(trainedSamples) / trainSeconds : 0.0},
+			{"step_ms_p50", percentile(stepSeconds, 0.50) * 1e3},
+			{"step_ms_p99", percentile(stepSeconds, 0.99) * 1e3},
+			{"loss_first", firstLoss},
+			{"loss_last", lastLoss},
+			{"predict_us_p50", percentile(predictSeconds, 0.50) * 1e6},
+			{"predict_us_p99", percentile(predictSeconds, 0.99) * 1e6},
+			{"predict_batch_samples_per_sec", batchSeconds > 0.0 ? static_cast<double>(batchCalls * maxRows) / batchSeconds : 0.0},
+			{"peak_rss_mb", static_cast<double>(usage.ru_maxrss) / 1024.0}
+		};
+	}
+
+	// One child process per model: ru_maxrss is a high-water mark, it would only grow in one process
+	json benchIsolated(const Model &model, const Options &options)
+	{
+		int fds[2];
+		if (::pipe(fds) != 0)
+			throw std::runtime_error("pipe failed");
+
+		const pid_t pid = ::fork();
+		if (pid < 0)
+			throw std::runtime_error("fork failed");
+
+		if (pid == 0)
+		{
+			::close(fds[0]);
+
+			std::string result;
+			try
+			{
+				result = benchModel(model, options).dump();
+			}
+			catch (const std::exception &ex)
+			{
+				result = json{{"model", model.name}, {"error", ex.what()}}.dump();
+			}
+
+			for (std::size_t written = 0; written < result.size();)
+			{
+				const auto n = ::write(fds[1], result.data() + written, result.size() - written);
+				if (n <= 0)
+					break;
+				written += static_cast<std::size_t>(n);
+			}
+
+			::close(fds[1]);
+			::_exit(0);
+		}
+
+		::close(fds[1]);
+
+		std::string result;
+		char buffer[4096];
+		for (ssize_t n; (n = ::read(fds[0], buffer, sizeof(buffer))) > 0;)
+			result.append(buffer, static_cast<std::size_t>(n));
+
+		::close(fds[0]);
+		::waitpid(pid, nullptr, 0);
+
+		if (result.empty())
+			return {{"model", model.name}, {"error", "benchmark process died"}};
+
+		return json::parse(result);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	Options options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--model" && hasValue)
+			options.model = argv[++i];
+		else if (arg == "--steps" && hasValue)
+			options.steps = std::stoul(argv[++i]);
+		else if (arg == "--warmup" && hasValue)
+			options.warmup = std::stoul(argv[++i]);
+		else if (arg == "--predict" && hasValue)
+			options.predictCalls = std::stoul(argv[++i]);
+		else if (arg == "--samples" && hasValue)
+			options.samples = std::stoul(argv[++i]);
+		else if (arg == "--dir" && hasValue)
+			options.dir = argv[++i];
+		else if (arg == "--json" && hasValue)
+			options.jsonPath = argv[++i];
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--model mlp|sequence|attention] [--steps N] [--warmup N]"
+				<< " [--predict N] [--samples N] [--dir path] [--json results.json]\n";
+			return 1;
+		}
+	}
+
+	::mkdir(options.dir.c_str(), 0755);
+
+	json results = json::array();
+	bool failed = false;
+
+	std::printf("%-10s %9s %12s %9s %9s %11s %11s %14s %9s\n",
+		"model", "params", "samples/s", "step p50", "step p99", "pred p50", "pred p99", "batch pred/s", "RSS MB");
+
+	for (const auto &model : models())
+	{
+		if (!options.model.empty() && model.name != options.model)
+			continue;
+
+		json result;
+		try
+		{
+			result = benchIsolated(model, options);
+		}
+		catch (const std::exception &ex)
+		{
+			result = {{"model", model.name}, {"error", ex.what()}};
+		}
+
+		if (result.contains("error"))
+		{
+			std::printf("%-10s error: %s\n", model.name.c_str(), result["error"].get<std::string>().c_str());
+			failed = true;
+		}
+		else
+		{
+			std::printf("%-10s %9zu %12.1f %7.2fms %7.2fms %9.1fus %9.1fus %14.1f %9.1f\n",
+				model.name.c_str(),
+				result["params"].get<std::size_t>(),
+				result["train_samples_per_sec"].get<double>(),
+				result["step_ms_p50"].get<double>(),
+				result["step_ms_p99"].get<double>(),
+				result["predict_us_p50"].get<double>(),
+				result["predict_us_p99"].get<double>(),
+				result["predict_batch_samples_per_sec"].get<double>(),
+				result["peak_rss_mb"].get<double>());
+		}
+
+		std::fflush(stdout);
+		results.push_back(result);
+	}
+
+	if (!options.jsonPath.empty())
+	{
+		json doc = {
+			#if PHP2XAI_USE_EIGEN
+				{"backend", "eigen"},
+			#else
+				{"backend", "naive"},
+			#endif
+			{"compiler", __VERSION__},
+			{"results", results}
+		};
+
+		std::ofstream out(options.jsonPath, std::ios::trunc);
+		out << doc.dump(1) << "\n";
+
+		if (!out)
+		{
+			std::cerr << "Error: unable to write " << options.jsonPath << "\n";
+			return 1;
+		}
+	}
+
+	return failed ? 1 : 0;
+}
@@ -121,6 +121,40 @@ class Tokenizer
 		}
 	}
 
+	/**
+	 * Encode the text and append the ids to a flat little-endian token file
+	 * (uint16 or uint32), the format read by the CPP TokenStreamDataset.
+	 *
+	 * @return int number of tokens written
+	 */
+	public function appendToTokenFile(string $text, string $path, int $tokenBytes = 2, bool $addSpecialTokens = true): int
+	{
+		if ($tokenBytes !== 2 && $tokenBytes !== 4)
+			throw new RuntimeException('tokenBytes must be 2 or 4');
+
+		$ids = $this->encode($text, $addSpecialTokens);
+
+		if ($tokenBytes === 2 && count($ids) > 0 && max($ids) > 0xFFFF)
+			throw new RuntimeException('Token id does not fit in uint16, use tokenBytes = 4');
+
+		$fh = fopen($path, 'ab');
+
+		if (!$fh)
+			throw new RuntimeException('Unable to open token file: '.$path);
+
+		try
+		{
+			foreach (array_chunk($ids, 8192) as $chunk)
+				fwrite($fh, pack($tokenBytes === 2 ? 'v*' : 'V*', ...$chunk));
+		}
+		finally
+		{
+			fclose($fh);
+		}
+
+		return count($ids);
+	}
+
 	public function free(): void
 	{
 		if ($this->handle !== null)